@@ -0,0 +1,190 @@
+// Arena and Pool against malloc on the allocation patterns the
+// interpreter has:
+//
+//   ast      many small nodes of mixed sizes, all freed together
+//            (Arena::reset against one free() per node)
+//   runtime  a fixed population of objects where each step frees one
+//            and allocates another, as the collector's sweep and the
+//            engines do (Pool against malloc/free)
+//   scratch  a few temporaries per step, dropped at once
+//            (Arena::mark/rewind against malloc/free)
+//
+// Prints nanoseconds per allocation for each side and what the arena
+// or pool reserved from the system.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "utils/arena.h"
+
+using namespace xerith;
+
+namespace {
+
+// Deterministic, so both sides of a comparison see the same sizes.
+struct Random {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<uint32_t>(state >> 32);
+    }
+};
+
+// Node sizes of the AST, and of functions, closures and upvalues.
+constexpr size_t AST_SIZES[] = {24, 32, 40, 48, 56, 72, 96};
+constexpr size_t OBJECT_SIZES[] = {48, 80, 96, 176};
+
+template <size_t N>
+size_t pick(const size_t (&sizes)[N], Random& random) {
+    return sizes[random.next() % N];
+}
+
+// Keeps the allocations observable, so none of them is optimised away.
+volatile uintptr_t sink;
+
+void touch(void* block, size_t size) {
+    std::memset(block, 0x5A, size < 16 ? size : 16);
+    sink = sink + reinterpret_cast<uintptr_t>(block);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Result {
+    double malloc_ns;
+    double arena_ns;
+    ArenaStats arena;
+};
+
+Result ast(int rounds, int nodes) {
+    std::vector<void*> blocks(nodes);
+    Random random;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < nodes; i++) {
+            size_t size = pick(AST_SIZES, random);
+            blocks[i] = std::malloc(size);
+            touch(blocks[i], size);
+        }
+        for (void* block : blocks) std::free(block);
+    }
+    double malloc_seconds = seconds_since(start);
+
+    Arena arena;
+    random = Random();
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < nodes; i++) {
+            size_t size = pick(AST_SIZES, random);
+            touch(arena.alloc(size), size);
+        }
+        if (r + 1 < rounds) arena.reset();
+    }
+    double arena_seconds = seconds_since(start);
+    double count = static_cast<double>(rounds) * nodes;
+    return {malloc_seconds * 1e9 / count, arena_seconds * 1e9 / count, arena.stats()};
+}
+
+Result runtime(int steps, int live, PoolStats* pool_stats) {
+    struct Block {
+        void* data;
+        size_t size;
+    };
+    std::vector<Block> blocks(live);
+    Random random;
+    auto start = std::chrono::steady_clock::now();
+    for (Block& block : blocks) {
+        block.size = pick(OBJECT_SIZES, random);
+        block.data = std::malloc(block.size);
+    }
+    for (int s = 0; s < steps; s++) {
+        Block& block = blocks[random.next() % live];
+        std::free(block.data);
+        block.size = pick(OBJECT_SIZES, random);
+        block.data = std::malloc(block.size);
+        touch(block.data, block.size);
+    }
+    for (Block& block : blocks) std::free(block.data);
+    double malloc_seconds = seconds_since(start);
+
+    Pool pool;
+    random = Random();
+    start = std::chrono::steady_clock::now();
+    for (Block& block : blocks) {
+        block.size = pick(OBJECT_SIZES, random);
+        block.data = pool.allocate(block.size);
+    }
+    for (int s = 0; s < steps; s++) {
+        Block& block = blocks[random.next() % live];
+        pool.deallocate(block.data, block.size);
+        block.size = pick(OBJECT_SIZES, random);
+        block.data = pool.allocate(block.size);
+        touch(block.data, block.size);
+    }
+    for (Block& block : blocks) pool.deallocate(block.data, block.size);
+    double pool_seconds = seconds_since(start);
+    *pool_stats = pool.stats();
+    double count = static_cast<double>(steps) + live;
+    return {malloc_seconds * 1e9 / count, pool_seconds * 1e9 / count, pool.arena_stats()};
+}
+
+Result scratch(int steps, int per_step) {
+    std::vector<void*> blocks(per_step);
+    Random random;
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+        for (int i = 0; i < per_step; i++) {
+            size_t size = pick(AST_SIZES, random);
+            blocks[i] = std::malloc(size);
+            touch(blocks[i], size);
+        }
+        for (void* block : blocks) std::free(block);
+    }
+    double malloc_seconds = seconds_since(start);
+
+    Arena arena;
+    arena.alloc(64);  // something older than the checkpoints, which must survive them
+    random = Random();
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+        Arena::Mark mark = arena.mark();
+        for (int i = 0; i < per_step; i++) {
+            size_t size = pick(AST_SIZES, random);
+            touch(arena.alloc(size), size);
+        }
+        arena.rewind(mark);
+    }
+    double arena_seconds = seconds_since(start);
+    double count = static_cast<double>(steps) * per_step;
+    return {malloc_seconds * 1e9 / count, arena_seconds * 1e9 / count, arena.stats()};
+}
+
+void print(const char* name, const char* side, const Result& result) {
+    std::printf("%-10s %10.2f %10.2f %8.2fx  %-6s %8zu KB in %zu chunks\n", name, result.malloc_ns, result.arena_ns,
+                result.malloc_ns / result.arena_ns, side, result.arena.bytes_reserved / 1024, result.arena.chunks);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // An optional argument scales every workload.
+    double scale = argc > 1 ? std::atof(argv[1]) : 1.0;
+    auto scaled = [scale](int n) { return static_cast<int>(n * scale) > 0 ? static_cast<int>(n * scale) : 1; };
+
+    std::printf("%-10s %10s %10s %9s  %-6s %s\n", "workload", "malloc ns", "ours ns", "speedup", "ours", "reserved");
+    print("ast", "arena", ast(scaled(20), 200000));
+
+    PoolStats pool_stats;
+    print("runtime", "pool", runtime(scaled(4000000), 20000, &pool_stats));
+    std::printf("%-10s %zu allocations, %zu from free lists\n", "", pool_stats.allocations, pool_stats.reused);
+
+    print("scratch", "arena", scratch(scaled(400000), 8));
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "bench_support.h"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <vector>
+
+std::atomic<size_t> allocation_count{0};
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+long current_rss_kb() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+long peak_rss_kb() {
+    // VmHWM honours reset_peak_rss(); ru_maxrss is the process peak.
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::atol(line.c_str() + 6);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+bool reset_peak_rss() {
+    // Writing 5 to clear_refs resets the kernel's high-water mark.
+    FILE* refs = std::fopen("/proc/self/clear_refs", "w");
+    if (refs == nullptr) return false;
+    bool ok = std::fputs("5", refs) >= 0;
+    return std::fclose(refs) == 0 && ok;
+}
+
+std::string generate_source(int blocks, const std::string& prefix) {
+    std::string source;
+    source.reserve(static_cast<size_t>(blocks) * (220 + 3 * prefix.size()));
+    std::vector<char> buffer(256 + 3 * prefix.size());
+    const char* name = prefix.c_str();
+    for (int i = 0; i < blocks; i++) {
+        std::snprintf(buffer.data(), buffer.size(),
+            "let %svalue_%d = (%d + 3) * 2 - %d / 4;\n"
+            "{\n"
+            "    let counter = 0;\n"
+            "    while (counter < 10) { counter = counter + 1; }\n"
+            "    if (%svalue_%d >= counter) print \"big\"; else print %svalue_%d;\n"
+            "}\n",
+            name, i, i, i, name, i, name, i);
+        source += buffer.data();
+    }
+    return source;
+}
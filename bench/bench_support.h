@@ -0,0 +1,29 @@
+#ifndef XERITH_BENCH_SUPPORT_H
+#define XERITH_BENCH_SUPPORT_H
+
+// Measuring helpers shared by the benchmark programs, so they count and
+// report the same way.
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// Every global operator new since the program started, on any thread.
+// Linking this unit replaces operator new/delete with malloc/free plus
+// the count.
+extern std::atomic<size_t> allocation_count;
+
+// Resident set size in KB right now, from /proc/self/statm.
+long current_rss_kb();
+// The most the process has had resident, or since reset_peak_rss().
+long peak_rss_kb();
+// Restarts peak_rss_kb() from the current size, so it reports the peak of
+// one phase. Returns false if the kernel does not support it.
+bool reset_peak_rss();
+
+// `blocks` blocks of a global, a block scope, a loop and a branch each:
+// the synthetic program the front-end benches measure. `prefix` starts
+// every global's name, so several such programs can share a namespace.
+std::string generate_source(int blocks, const std::string& prefix = "");
+
+#endif // XERITH_BENCH_SUPPORT_H
@@ -0,0 +1,76 @@
+// Lexer throughput in MB/s on two generated programs: one dense with
+// identifiers and keywords, one dominated by indentation, comments and
+// long string literals. Every token is pulled through next_token() and
+// discarded, so the numbers cover scanning, keyword recognition and
+// interning only.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "lexer/lexer.h"
+#include "utils/source_manager.h"
+
+using namespace xerith;
+
+static std::string generate_source(int blocks) {
+    std::string source;
+    source.reserve(static_cast<size_t>(blocks) * 260);
+    char buffer[320];
+    for (int i = 0; i < blocks; i++) {
+        std::snprintf(buffer, sizeof(buffer),
+            "let total_%d = 0;\n"
+            "for (let index = 0; index < %d; index = index + 1) {\n"
+            "    if (index >= limit and flag_%d == true) print \"over\"; else total_%d = total_%d + index * 2.5;\n"
+            "    while (running or waiting) { running = false; }\n"
+            "}\n",
+            i, i % 97, i % 13, i, i);
+        source += buffer;
+    }
+    return source;
+}
+
+static std::string generate_commented_source(int blocks) {
+    std::string source;
+    source.reserve(static_cast<size_t>(blocks) * 400);
+    char buffer[512];
+    for (int i = 0; i < blocks; i++) {
+        std::snprintf(buffer, sizeof(buffer),
+            "// Block %d: the comment runs on for a while so that skipping it dominates the line.\n"
+            "{\n"
+            "                let message_%d = \"a string literal long enough to be worth scanning in bulk %d\";\n"
+            "\n"
+            "                        // indented comment, also longer than a single vector width\n"
+            "                        print message_%d;\n"
+            "}\n",
+            i, i, i, i);
+        source += buffer;
+    }
+    return source;
+}
+
+static void measure(const char* label, FileId file, int rounds) {
+    double megabytes = static_cast<double>(SourceManager::text(file).size()) / (1024.0 * 1024.0);
+
+    double best = 1e9;
+    size_t tokens = 0;
+    for (int round = 0; round < rounds; round++) {
+        auto start = std::chrono::steady_clock::now();
+        Lexer lexer(file);
+        tokens = 0;
+        while (lexer.next_token().type != TokenType::END_OF_FILE) tokens++;
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::printf("%-10s %6.2f MB, %8zu tokens: %7.1f MB/s, %5.1f M tokens/s (best of %d)\n",
+                label, megabytes, tokens, megabytes / best, tokens / best / 1e6, rounds);
+}
+
+int main(int argc, char* argv[]) {
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 40000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+    measure("code:", SourceManager::add("generated.xrth", generate_source(blocks)), rounds);
+    measure("comments:", SourceManager::add("commented.xrth", generate_commented_source(blocks)), rounds);
+    return 0;
+}
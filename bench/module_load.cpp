@@ -0,0 +1,43 @@
+// Front-end time for a multi-file program, loaded with 1, 2, 4, ... up to
+// the number of hardware threads. Each file is bench_parse's program with
+// its globals renamed apart; the speedup column is relative to one thread.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_support.h"
+#include "driver/module_loader.h"
+#include "utils/source_manager.h"
+
+using namespace xerith;
+
+int main(int argc, char* argv[]) {
+    int module_count = argc > 1 ? std::atoi(argv[1]) : 32;
+    int blocks = argc > 2 ? std::atoi(argv[2]) : 2000;
+    unsigned max_jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<FileId> files;
+    size_t bytes = 0;
+    for (int m = 0; m < module_count; m++) {
+        std::string name = "module_" + std::to_string(m) + ".xrth";
+        files.push_back(SourceManager::add(name, generate_source(blocks, "m" + std::to_string(m) + "_")));
+        bytes += SourceManager::text(files.back()).size();
+    }
+    std::printf("%d modules, %.2f MB\n", module_count, bytes / (1024.0 * 1024.0));
+
+    double single = 0;
+    for (unsigned jobs = 1;; jobs = std::min(jobs * 2, max_jobs)) {
+        auto start = std::chrono::steady_clock::now();
+        GlobalTable globals;
+        std::vector<Module> modules = ModuleLoader(jobs).load(files, globals);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (jobs == 1) single = seconds;
+        std::printf("jobs %2u: %.3f s  (x%.2f)\n", jobs, seconds, single / seconds);
+        if (jobs == max_jobs) break;
+    }
+    return 0;
+}
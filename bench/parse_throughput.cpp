@@ -0,0 +1,95 @@
+// Parse throughput and memory on a large generated program.
+// Reports lexing and parsing speed, heap allocations made by the parser,
+// how much the process grew while building the tree, and how long it
+// takes to free the whole program again. A second, expression-heavy
+// program then times the expression parser on its own terms.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "bench_support.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "utils/source_manager.h"
+
+using namespace xerith;
+
+// Long statements that touch every binary precedence level, with unary
+// operators and parentheses mixed in.
+static std::string generate_expression_source(int blocks) {
+    std::string source;
+    source.reserve(static_cast<size_t>(blocks) * 200);
+    char buffer[256];
+    for (int i = 0; i < blocks; i++) {
+        std::snprintf(buffer, sizeof(buffer),
+            "let e_%d = -a * (b + %d) / c - d * 2 + e / -f;\n"
+            "e_%d = x < y == !(z >= %d) != w * w + 1 > v - u / 3;\n"
+            "print ((a + b) * (c - d) / (e + f * (g - h))) <= i;\n",
+            i, i, i, i);
+        source += buffer;
+    }
+    return source;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 50000;
+    std::string source = generate_source(blocks);
+    double megabytes = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+
+    FileId file = SourceManager::add("generated.xrth", std::move(source));
+    // Lexing alone, counting tokens without keeping them.
+    auto start = std::chrono::steady_clock::now();
+    size_t token_count = 0;
+    Lexer counter(file);
+    while (counter.next_token().type != TokenType::END_OF_FILE) token_count++;
+    double lex_seconds = seconds_since(start);
+
+    long rss_before = current_rss_kb();
+    size_t allocs_before = allocation_count;
+    start = std::chrono::steady_clock::now();
+
+    // The parser drives a fresh lexer, so this times both together.
+    Lexer lexer(file);
+    Arena arena(64 * 1024);
+    Parser parser(lexer, arena);
+    StmtList statements = parser.parse();
+
+    double parse_seconds = seconds_since(start);
+    size_t parse_allocs = allocation_count - allocs_before;
+    long rss_after = current_rss_kb();
+
+    start = std::chrono::steady_clock::now();
+    arena.reset();
+    double free_seconds = seconds_since(start);
+
+    std::printf("source:           %.2f MB, %zu tokens, %zu top-level statements\n",
+                megabytes, token_count, statements.size());
+    std::printf("lex:              %.1f MB/s\n", megabytes / lex_seconds);
+    std::printf("lex+parse:        %.1f MB/s (%.3f s)\n", megabytes / parse_seconds, parse_seconds);
+    std::printf("parse allocs:     %zu\n", parse_allocs);
+    std::printf("rss growth:       %ld KB during parse\n", rss_after - rss_before);
+    std::printf("peak rss:         %ld KB\n", peak_rss_kb());
+    std::printf("free program:     %.4f s\n", free_seconds);
+
+    FileId expressions = SourceManager::add("expressions.xrth", generate_expression_source(blocks));
+    double expression_megabytes = static_cast<double>(SourceManager::text(expressions).size()) / (1024.0 * 1024.0);
+    double best = 1e9;
+    for (int round = 0; round < 5; round++) {
+        start = std::chrono::steady_clock::now();
+        Lexer expression_lexer(expressions);
+        Parser expression_parser(expression_lexer, arena);
+        expression_parser.parse();
+        best = std::min(best, seconds_since(start));
+        arena.reset();
+    }
+    std::printf("expressions:      %.1f MB/s lex+parse (%.2f MB, best of 5)\n",
+                expression_megabytes / best, expression_megabytes);
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Counts heap allocations per loop iteration in the tree-walking
+// interpreter. A `for` loop with a block body used to allocate a fresh
+// Environment (and hash map) for the body and for the desugared increment
+// block on every iteration; with the value stack it should allocate
+// nothing once the loop is running.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench_support.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "runtime/interpreter.h"
+#include "sema/resolver.h"
+#include "utils/source_manager.h"
+
+using namespace xerith;
+
+struct Sample {
+    size_t allocations;
+    double seconds;
+};
+
+static Sample run_loop(const char* shape, int iterations) {
+    char source[512];
+    std::snprintf(source, sizeof(source), shape, iterations);
+
+    Lexer lexer(SourceManager::add("bench", source));
+    Arena arena;
+    Parser parser(lexer, arena);
+    StmtList statements = parser.parse();
+    GlobalTable globals;
+    Resolver resolver(globals);
+    resolver.resolve(statements);
+
+    Interpreter interpreter;
+    size_t before = allocation_count;
+    auto start = std::chrono::steady_clock::now();
+    interpreter.interpret(statements);
+    auto end = std::chrono::steady_clock::now();
+    return {allocation_count - before, std::chrono::duration<double>(end - start).count()};
+}
+
+int main() {
+    struct Case {
+        const char* name;
+        const char* source;
+    };
+    const Case cases[] = {
+        {"for, block body with a local",
+         "{ let total = 0; for (let i = 0; i < %d; i = i + 1) { let x = i * 2; total = total + x; } }"},
+        {"for, block body without locals",
+         "{ let total = 0; for (let i = 0; i < %d; i = i + 1) { total = total + i; } }"},
+        {"while, nested empty blocks",
+         "{ let i = 0; while (i < %d) { { { i = i + 1; } } } }"},
+    };
+
+    const int small = 100000;
+    const int large = 200000;
+
+    std::printf("%-34s %16s %14s\n", "case", "allocs/iteration", "ns/iteration");
+    for (const Case& c : cases) {
+        // Subtracting two runs cancels the fixed setup cost.
+        Sample a = run_loop(c.source, small);
+        Sample b = run_loop(c.source, large);
+        double per_iteration = static_cast<double>(b.allocations - a.allocations) / (large - small);
+        double ns = (b.seconds - a.seconds) * 1e9 / (large - small);
+        std::printf("%-34s %16.2f %14.1f\n", c.name, per_iteration, ns);
+    }
+    return 0;
+}
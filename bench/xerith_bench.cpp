@@ -0,0 +1,202 @@
+// Regression harness: runs every program in the corpus through each phase
+// of the pipeline separately and prints one JSON document with the wall
+// time, heap allocations and peak RSS of every phase.
+//
+//   xerith_bench [--repeat N] [--corpus DIR] [--blocks N] [name...]
+//
+// The corpus is every .xrth file in bench/ plus "generated_large", a
+// program of --blocks synthetic blocks built in memory. Naming programs
+// runs only those. With --repeat, each phase reports its fastest run.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_support.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "runtime/interpreter.h"
+#include "sema/constant_folder.h"
+#include "sema/resolver.h"
+#include "utils/source_manager.h"
+#include "vm/compiler.h"
+#include "vm/vm.h"
+
+using namespace xerith;
+
+// Swallows the programs' own output so it cannot corrupt the JSON.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Phase {
+    const char* name;
+    double seconds = 0;
+    size_t allocations = 0;
+    long peak_rss_kb = 0;
+    bool ok = true;
+};
+
+class MeasuredPhase {
+public:
+    explicit MeasuredPhase(Phase& phase) : phase(phase) {
+        reset_peak_rss();
+        allocations = allocation_count;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~MeasuredPhase() {
+        phase.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        phase.allocations = allocation_count - allocations;
+        phase.peak_rss_kb = peak_rss_kb();
+    }
+
+private:
+    Phase& phase;
+    size_t allocations;
+    std::chrono::steady_clock::time_point start;
+};
+
+struct Program {
+    std::string name;
+    FileId file;
+};
+
+// The front end and both engines, each phase starting from the output
+// of the one before, so a phase's numbers never include its inputs.
+static std::vector<Phase> run_phases(FileId file, size_t* token_count) {
+    std::vector<Phase> phases = {{"lex"}, {"parse"}, {"resolve"}, {"interpret"}, {"compile"}, {"vm"}};
+    NullBuffer null;
+    std::streambuf* saved = std::cout.rdbuf();
+
+    {
+        MeasuredPhase timer(phases[0]);
+        Lexer lexer(file);
+        size_t count = 0;
+        while (lexer.next_token().type != TokenType::END_OF_FILE) count++;
+        *token_count = count;
+    }
+
+    Arena arena(64 * 1024);
+    StmtList statements;
+    {
+        MeasuredPhase timer(phases[1]);
+        Lexer lexer(file);
+        Parser parser(lexer, arena);
+        statements = parser.parse();
+        phases[1].ok = !parser.had_error();
+    }
+
+    GlobalTable globals;
+    {
+        MeasuredPhase timer(phases[2]);
+        ConstantFolder folder(arena);
+        folder.fold(statements);
+        Resolver resolver(globals);
+        resolver.resolve(statements);
+    }
+
+    {
+        Interpreter interpreter;
+        std::cout.rdbuf(&null);
+        MeasuredPhase timer(phases[3]);
+        interpreter.interpret(statements);
+    }
+    std::cout.rdbuf(saved);
+
+    Chunk chunk;
+    {
+        MeasuredPhase timer(phases[4]);
+        Compiler compiler;
+        phases[4].ok = compiler.compile(statements, chunk);
+    }
+
+    if (phases[4].ok) {
+        VM vm;
+        std::cout.rdbuf(&null);
+        MeasuredPhase timer(phases[5]);
+        phases[5].ok = vm.interpret(chunk) == InterpretResult::OK;
+    } else {
+        phases[5].ok = false;
+    }
+    std::cout.rdbuf(saved);
+    return phases;
+}
+
+static std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static int usage() {
+    std::cerr << "Usage: xerith_bench [--repeat N] [--corpus DIR] [--blocks N] [name...]" << std::endl;
+    return 64;
+}
+
+int main(int argc, char* argv[]) {
+    int repeat = 1;
+    int blocks = 10000;
+    std::string corpus = XERITH_BENCH_CORPUS;
+    std::vector<std::string> only;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--corpus" && i + 1 < argc) corpus = argv[++i];
+        else if (arg == "--blocks" && i + 1 < argc) blocks = std::atoi(argv[++i]);
+        else if (arg.compare(0, 2, "--") == 0) return usage();
+        else only.push_back(arg);
+    }
+
+    std::vector<Program> programs;
+    std::vector<std::filesystem::path> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(corpus, error)) {
+        if (entry.path().extension() == ".xrth") paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const auto& path : paths) {
+        FileId file = SourceManager::load(path.string());
+        if (file != 0) programs.push_back({path.stem().string(), file});
+    }
+    if (blocks > 0) programs.push_back({"generated_large", SourceManager::add("generated_large.xrth", generate_source(blocks))});
+
+    auto wanted = [&](const std::string& name) {
+        return only.empty() || std::find(only.begin(), only.end(), name) != only.end();
+    };
+
+    std::printf("{\n  \"repeat\": %d,\n  \"benchmarks\": [", repeat);
+    bool first_program = true;
+    for (const Program& program : programs) {
+        if (!wanted(program.name)) continue;
+        size_t tokens = 0;
+        std::vector<Phase> best = run_phases(program.file, &tokens);
+        for (int r = 1; r < repeat; r++) {
+            std::vector<Phase> again = run_phases(program.file, &tokens);
+            for (size_t p = 0; p < best.size(); p++) best[p].seconds = std::min(best[p].seconds, again[p].seconds);
+        }
+
+        std::printf("%s\n    {\"name\": %s, \"source_bytes\": %zu, \"tokens\": %zu, \"phases\": [",
+                    first_program ? "" : ",", json_string(program.name).c_str(),
+                    SourceManager::text(program.file).size(), tokens);
+        first_program = false;
+        for (size_t p = 0; p < best.size(); p++) {
+            const Phase& phase = best[p];
+            std::printf("%s\n      {\"phase\": \"%s\", \"seconds\": %.6f, \"allocations\": %zu, "
+                        "\"peak_rss_kb\": %ld, \"ok\": %s}",
+                        p == 0 ? "" : ",", phase.name, phase.seconds, phase.allocations,
+                        phase.peak_rss_kb, phase.ok ? "true" : "false");
+        }
+        std::printf("\n    ]}");
+    }
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
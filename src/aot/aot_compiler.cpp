@@ -0,0 +1,365 @@
+#include "aot_compiler.h"
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include "../vm/bytecode.h"
+
+namespace xerith {
+
+namespace {
+
+/**
+ * @brief Lowers a whole program into `int main()`.
+ * Every expression evaluates into its own temporary Value slot, which
+ * the consumer releases once done with it; slots are nil whenever they
+ * are not in use, so loops can reuse them without re-initialising.
+ */
+class ProgramLowering : public ExprVisitor, public StmtVisitor {
+public:
+    ProgramLowering(llvm::LLVMContext& context, llvm::Module& module)
+        : context(context), module(module), builder(context) {
+        value_type = llvm::StructType::create(context, {builder.getInt64Ty(), builder.getInt64Ty()}, "xerith.value");
+        value_ptr = value_type->getPointerTo();
+        declare_runtime();
+    }
+
+    void lower(const StmtList& statements) {
+        main = llvm::Function::Create(llvm::FunctionType::get(builder.getInt32Ty(), false),
+                                      llvm::Function::ExternalLinkage, "main", module);
+        entry = llvm::BasicBlock::Create(context, "entry", main);
+        auto* init = llvm::BasicBlock::Create(context, "init", main);
+        auto* body = llvm::BasicBlock::Create(context, "body", main);
+
+        builder.SetInsertPoint(body);
+        for (Stmt* statement : statements) statement->accept(*this);
+        builder.CreateRet(builder.getInt32(0));
+
+        builder.SetInsertPoint(init);
+        builder.CreateCall(rt_globals, {builder.getInt32(static_cast<uint32_t>(globals.size()))});
+        for (const auto& [text, constant] : strings) {
+            builder.CreateCall(rt_string, {constant, builder.CreateGlobalStringPtr(text),
+                                           builder.getInt64(text.size())});
+        }
+        builder.CreateBr(body);
+
+        builder.SetInsertPoint(entry);
+        builder.CreateBr(init);
+    }
+
+    // Stmt Visitor Methods
+    void visit_print_stmt(PrintStmt& stmt) override {
+        llvm::Value* value = lower(*stmt.expression);
+        builder.CreateCall(rt_print, {value});
+        release(value);
+    }
+
+    void visit_expression_stmt(ExpressionStmt& stmt) override {
+        release(lower(*stmt.expression));
+    }
+
+    void visit_var_stmt(VarStmt& stmt) override {
+        llvm::Value* value = stmt.initializer != nullptr ? lower(*stmt.initializer) : make_temp();
+        if (stmt.slot < 0) {
+            builder.CreateCall(rt_global_define, {global_index(stmt.name.lexeme), value});
+        } else {
+            builder.CreateCall(rt_assign, {local(stmt.slot), value});
+            declared.push_back(stmt.slot);
+        }
+        release(value);
+    }
+
+    void visit_block_stmt(BlockStmt& stmt) override {
+        size_t mark = declared.size();
+        for (Stmt* statement : stmt.statements) statement->accept(*this);
+        // Like the Compiler's POPs: drop what this block's own locals hold.
+        for (; declared.size() > mark; declared.pop_back()) release(local(declared.back()));
+    }
+
+    void visit_while_stmt(WhileStmt& stmt) override {
+        auto* header = llvm::BasicBlock::Create(context, "loop", main);
+        auto* body = llvm::BasicBlock::Create(context, "loop.body", main);
+        auto* exit = llvm::BasicBlock::Create(context, "loop.exit", main);
+        builder.CreateBr(header);
+
+        builder.SetInsertPoint(header);
+        builder.CreateCondBr(lower_condition(*stmt.condition), body, exit);
+
+        builder.SetInsertPoint(body);
+        stmt.body->accept(*this);
+        builder.CreateBr(header);
+
+        builder.SetInsertPoint(exit);
+    }
+
+    void visit_if_stmt(IfStmt& stmt) override {
+        auto* then_block = llvm::BasicBlock::Create(context, "if.then", main);
+        auto* else_block = llvm::BasicBlock::Create(context, "if.else", main);
+        auto* merge = llvm::BasicBlock::Create(context, "if.end", main);
+        builder.CreateCondBr(lower_condition(*stmt.condition), then_block, else_block);
+
+        builder.SetInsertPoint(then_block);
+        stmt.then_branch->accept(*this);
+        builder.CreateBr(merge);
+
+        builder.SetInsertPoint(else_block);
+        if (stmt.else_branch != nullptr) stmt.else_branch->accept(*this);
+        builder.CreateBr(merge);
+
+        builder.SetInsertPoint(merge);
+    }
+
+    void visit_function_stmt(FunctionStmt&) override {
+        throw std::runtime_error("Functions are not supported by `xerith build` yet.");
+    }
+
+    void visit_return_stmt(ReturnStmt&) override {
+        throw std::runtime_error("Functions are not supported by `xerith build` yet.");
+    }
+
+    // Expr Visitor Methods. The returned Value is unused; the slot holding
+    // the result is left in `result`.
+    Value visit_binary_expr(BinaryExpr& expr) override {
+        llvm::Value* left = lower(*expr.left);
+        llvm::Value* right = lower(*expr.right);
+        llvm::Value* out = make_temp();
+        builder.CreateCall(rt_binary, {op_constant(binary_op(expr.op.type)), out, left, right});
+        release(left);
+        release(right);
+        result = out;
+        return Value();
+    }
+
+    Value visit_unary_expr(UnaryExpr& expr) override {
+        llvm::Value* operand = lower(*expr.right);
+        llvm::Value* out = make_temp();
+        OpCode op = expr.op.type == TokenType::MINUS ? OpCode::NEGATE
+                  : expr.op.type == TokenType::BANG  ? OpCode::NOT
+                  : OpCode::NIL;
+        builder.CreateCall(rt_unary, {op_constant(op), out, operand});
+        release(operand);
+        result = out;
+        return Value();
+    }
+
+    Value visit_literal_expr(LiteralExpr& expr) override {
+        const Value& constant = expr.constant;
+        llvm::Value* out = make_temp();
+        if (constant.is_number()) {
+            builder.CreateCall(rt_number, {out, llvm::ConstantFP::get(builder.getDoubleTy(), constant.as_number())});
+        } else if (constant.is_bool()) {
+            builder.CreateCall(rt_bool, {out, builder.getInt1(constant.as_bool())});
+        } else if (constant.is_string()) {
+            builder.CreateCall(rt_copy, {out, string_constant(constant.as_string())});
+        }
+        result = out;
+        return Value();
+    }
+
+    Value visit_grouping_expr(GroupingExpr& expr) override {
+        result = lower(*expr.expression);
+        return Value();
+    }
+
+    Value visit_variable_expr(VariableExpr& expr) override {
+        llvm::Value* out = make_temp();
+        if (expr.target.is_global()) {
+            builder.CreateCall(rt_global_get, {global_index(expr.name.lexeme), name_constant(expr.name.lexeme), out});
+        } else {
+            builder.CreateCall(rt_copy, {out, local(expr.target.slot)});
+        }
+        result = out;
+        return Value();
+    }
+
+    Value visit_assign_expr(AssignExpr& expr) override {
+        llvm::Value* value = lower(*expr.value);
+        if (expr.target.is_global()) {
+            builder.CreateCall(rt_global_set, {global_index(expr.name.lexeme), name_constant(expr.name.lexeme), value});
+        } else {
+            builder.CreateCall(rt_assign, {local(expr.target.slot), value});
+        }
+        result = value;
+        return Value();
+    }
+
+    Value visit_call_expr(CallExpr&) override {
+        throw std::runtime_error("Functions are not supported by `xerith build` yet.");
+    }
+
+private:
+    llvm::Value* lower(Expr& expr) {
+        expr.accept(*this);
+        return result;
+    }
+
+    llvm::Value* lower_condition(Expr& expr) {
+        llvm::Value* value = lower(expr);
+        llvm::Value* truthy = builder.CreateCall(rt_truthy, {value});
+        release(value);
+        return truthy;
+    }
+
+    void release(llvm::Value* value) { builder.CreateCall(rt_release, {value}); }
+
+    // A fresh nil slot in main's frame.
+    llvm::Value* make_temp() {
+        llvm::IRBuilder<> entry_builder(entry, entry->begin());
+        llvm::AllocaInst* slot = entry_builder.CreateAlloca(value_type);
+        entry_builder.CreateStore(llvm::ConstantAggregateZero::get(value_type), slot);
+        return slot;
+    }
+
+    llvm::Value* local(int slot) {
+        llvm::Value*& variable = locals[slot];
+        if (variable == nullptr) variable = make_temp();
+        return variable;
+    }
+
+    llvm::Value* global_index(std::string_view name) {
+        auto it = globals.emplace(name, static_cast<uint32_t>(globals.size())).first;
+        return builder.getInt32(it->second);
+    }
+
+    llvm::Value* name_constant(std::string_view name) {
+        llvm::Value*& constant = names[name];
+        if (constant == nullptr) constant = builder.CreateGlobalStringPtr(llvm::StringRef(name.data(), name.size()));
+        return constant;
+    }
+
+    // String literals are built once in `init` and copied on each use.
+    llvm::Value* string_constant(const std::string& text) {
+        llvm::Value*& constant = strings[text];
+        if (constant == nullptr) {
+            constant = new llvm::GlobalVariable(module, value_type, false, llvm::GlobalValue::InternalLinkage,
+                                                llvm::ConstantAggregateZero::get(value_type), "str");
+        }
+        return constant;
+    }
+
+    llvm::Value* op_constant(OpCode op) { return builder.getInt8(static_cast<uint8_t>(op)); }
+
+    static OpCode binary_op(TokenType type) {
+        switch (type) {
+            case TokenType::PLUS:          return OpCode::ADD;
+            case TokenType::MINUS:         return OpCode::SUBTRACT;
+            case TokenType::STAR:          return OpCode::MULTIPLY;
+            case TokenType::SLASH:         return OpCode::DIVIDE;
+            case TokenType::GREATER:       return OpCode::GREATER;
+            case TokenType::GREATER_EQUAL: return OpCode::GREATER_EQUAL;
+            case TokenType::LESS:          return OpCode::LESS;
+            case TokenType::LESS_EQUAL:    return OpCode::LESS_EQUAL;
+            case TokenType::EQUAL_EQUAL:   return OpCode::EQUAL;
+            case TokenType::BANG_EQUAL:    return OpCode::NOT_EQUAL;
+            // The tree-walker yields nil for operators it does not know.
+            default:                       return OpCode::NIL;
+        }
+    }
+
+    void declare_runtime() {
+        auto* void_type = builder.getVoidTy();
+        auto* i8 = builder.getInt8Ty();
+        auto* i32 = builder.getInt32Ty();
+        auto* chars = builder.getInt8PtrTy();
+        auto declare = [&](const char* name, llvm::Type* result, std::vector<llvm::Type*> params) {
+            return module.getOrInsertFunction(name, llvm::FunctionType::get(result, params, false));
+        };
+        rt_globals = declare("xrt_globals", void_type, {i32});
+        rt_global_define = declare("xrt_global_define", void_type, {i32, value_ptr});
+        rt_global_get = declare("xrt_global_get", void_type, {i32, chars, value_ptr});
+        rt_global_set = declare("xrt_global_set", void_type, {i32, chars, value_ptr});
+        rt_number = declare("xrt_number", void_type, {value_ptr, builder.getDoubleTy()});
+        rt_bool = declare("xrt_bool", void_type, {value_ptr, builder.getInt1Ty()});
+        // C++ bool crosses the ABI as a zero-extended byte.
+        llvm::cast<llvm::Function>(rt_bool.getCallee())->addParamAttr(1, llvm::Attribute::ZExt);
+        rt_string = declare("xrt_string", void_type, {value_ptr, chars, builder.getInt64Ty()});
+        rt_copy = declare("xrt_copy", void_type, {value_ptr, value_ptr});
+        rt_assign = declare("xrt_assign", void_type, {value_ptr, value_ptr});
+        rt_release = declare("xrt_release", void_type, {value_ptr});
+        rt_unary = declare("xrt_unary", void_type, {i8, value_ptr, value_ptr});
+        rt_binary = declare("xrt_binary", void_type, {i8, value_ptr, value_ptr, value_ptr});
+        rt_truthy = declare("xrt_truthy", builder.getInt1Ty(), {value_ptr});
+        llvm::cast<llvm::Function>(rt_truthy.getCallee())->addRetAttr(llvm::Attribute::ZExt);
+        rt_print = declare("xrt_print", void_type, {value_ptr});
+    }
+
+    llvm::LLVMContext& context;
+    llvm::Module& module;
+    llvm::IRBuilder<> builder;
+    llvm::StructType* value_type = nullptr;
+    llvm::PointerType* value_ptr = nullptr;
+    llvm::Function* main = nullptr;
+    llvm::BasicBlock* entry = nullptr;
+    llvm::Value* result = nullptr;
+    // Slots of the locals declared so far in the enclosing blocks,
+    // innermost last.
+    std::vector<int> declared;
+
+    std::unordered_map<std::string_view, uint32_t> globals;
+    std::unordered_map<std::string_view, llvm::Value*> names;
+    std::unordered_map<std::string, llvm::Value*> strings;
+    std::unordered_map<int, llvm::Value*> locals;
+
+    llvm::FunctionCallee rt_globals, rt_global_define, rt_global_get, rt_global_set;
+    llvm::FunctionCallee rt_number, rt_bool, rt_string;
+    llvm::FunctionCallee rt_copy, rt_assign, rt_release;
+    llvm::FunctionCallee rt_unary, rt_binary, rt_truthy, rt_print;
+};
+
+void emit_object(llvm::Module& module, const std::string& path) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (target == nullptr) throw std::runtime_error(error);
+
+    std::unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(
+        triple, "generic", "", llvm::TargetOptions(), llvm::Reloc::PIC_));
+    module.setTargetTriple(triple);
+    module.setDataLayout(machine->createDataLayout());
+
+    std::error_code ec;
+    llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+    if (ec) throw std::runtime_error("Could not open '" + path + "': " + ec.message());
+
+    llvm::legacy::PassManager passes;
+    if (machine->addPassesToEmitFile(passes, out, nullptr, llvm::CGFT_ObjectFile)) {
+        throw std::runtime_error("Target cannot emit object files.");
+    }
+    passes.run(module);
+    out.flush();
+}
+
+} // namespace
+
+bool AotCompiler::compile(const StmtList& statements, const std::string& module_name, const std::string& output_path) {
+    llvm::LLVMContext context;
+    llvm::Module module(module_name, context);
+    try {
+        ProgramLowering lowering(context, module);
+        lowering.lower(statements);
+        if (llvm::verifyModule(module, &llvm::errs())) throw std::runtime_error("Generated invalid IR.");
+        emit_object(module, output_path);
+    } catch (const std::runtime_error& error) {
+        std::cerr << "[Compile Error] " << error.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace xerith
@@ -0,0 +1,25 @@
+#ifndef XERITH_AOT_COMPILER_H
+#define XERITH_AOT_COMPILER_H
+
+#include <string>
+#include "../parser/ast.h"
+
+namespace xerith {
+
+/**
+ * @brief Compiles a resolved program to a native object file.
+ * The object defines `main` and calls into libxerith_rt (see
+ * aot/runtime.h) for every value operation, so linking the two gives a
+ * standalone executable that skips lexing, parsing and resolution at
+ * startup. Globals are numbered at compile time; block-scoped variables
+ * and temporaries are stack slots in `main`'s frame.
+ */
+class AotCompiler {
+public:
+    // Returns false (after reporting) if code generation or emission fails.
+    bool compile(const StmtList& statements, const std::string& module_name, const std::string& output_path);
+};
+
+} // namespace xerith
+
+#endif // XERITH_AOT_COMPILER_H
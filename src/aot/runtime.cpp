@@ -0,0 +1,114 @@
+#include "runtime.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "../vm/bytecode.h"
+
+using xerith::OpCode;
+using xerith::Value;
+
+namespace {
+
+struct Global {
+    Value value;
+    bool defined = false;
+};
+
+std::vector<Global>& globals() {
+    static std::vector<Global> table;
+    return table;
+}
+
+[[noreturn]] void runtime_error(const std::string& message) {
+    std::cout.flush();
+    std::cerr << "Runtime Error: " << message << std::endl;
+    std::exit(70);
+}
+
+[[noreturn]] void undefined(const char* name) {
+    runtime_error("Undefined variable '" + std::string(name) + "'.");
+}
+
+void check_numbers(const Value& left, const Value& right) {
+    if (!left.is_number() || !right.is_number()) runtime_error("Operands must be numbers.");
+}
+
+} // namespace
+
+extern "C" {
+
+void xrt_globals(uint32_t count) { globals().resize(count); }
+
+void xrt_global_define(uint32_t index, const Value* value) {
+    Global& global = globals()[index];
+    global.value = *value;
+    global.defined = true;
+}
+
+void xrt_global_get(uint32_t index, const char* name, Value* out) {
+    const Global& global = globals()[index];
+    if (!global.defined) undefined(name);
+    *out = global.value;
+}
+
+void xrt_global_set(uint32_t index, const char* name, const Value* value) {
+    Global& global = globals()[index];
+    if (!global.defined) undefined(name);
+    global.value = *value;
+}
+
+void xrt_number(Value* out, double number) { *out = Value(number); }
+void xrt_bool(Value* out, bool boolean) { *out = Value(boolean); }
+void xrt_string(Value* out, const char* chars, uint64_t length) { *out = Value(std::string(chars, length)); }
+
+void xrt_copy(Value* out, const Value* value) { *out = *value; }
+void xrt_assign(Value* target, const Value* value) { *target = *value; }
+void xrt_release(Value* value) { *value = Value(); }
+
+void xrt_unary(uint8_t op, Value* out, const Value* operand) {
+    switch (static_cast<OpCode>(op)) {
+        case OpCode::NEGATE:
+            if (!operand->is_number()) runtime_error("Operand must be a number.");
+            *out = Value(-operand->as_number());
+            return;
+        case OpCode::NOT:
+            *out = Value(!xerith::is_truthy(*operand));
+            return;
+        default:
+            *out = Value();
+            return;
+    }
+}
+
+void xrt_binary(uint8_t op, Value* out, const Value* left, const Value* right) {
+    const Value& a = *left;
+    const Value& b = *right;
+    switch (static_cast<OpCode>(op)) {
+        case OpCode::ADD:
+            if (a.is_number() && b.is_number()) *out = Value(a.as_number() + b.as_number());
+            else if (a.is_string() && b.is_string()) *out = xerith::concat(a, b);
+            else runtime_error("Operands must be two numbers or two strings.");
+            return;
+        case OpCode::SUBTRACT:      check_numbers(a, b); *out = Value(a.as_number() - b.as_number()); return;
+        case OpCode::MULTIPLY:      check_numbers(a, b); *out = Value(a.as_number() * b.as_number()); return;
+        case OpCode::DIVIDE:        check_numbers(a, b); *out = Value(a.as_number() / b.as_number()); return;
+        case OpCode::GREATER:       check_numbers(a, b); *out = Value(a.as_number() > b.as_number()); return;
+        case OpCode::GREATER_EQUAL: check_numbers(a, b); *out = Value(a.as_number() >= b.as_number()); return;
+        case OpCode::LESS:          check_numbers(a, b); *out = Value(a.as_number() < b.as_number()); return;
+        case OpCode::LESS_EQUAL:    check_numbers(a, b); *out = Value(a.as_number() <= b.as_number()); return;
+        case OpCode::EQUAL:         *out = Value(xerith::values_equal(a, b)); return;
+        case OpCode::NOT_EQUAL:     *out = Value(!xerith::values_equal(a, b)); return;
+        default:                    *out = Value(); return;
+    }
+}
+
+bool xrt_truthy(const Value* value) { return xerith::is_truthy(*value); }
+
+void xrt_print(const Value* value) {
+    // No per-line flush; the stream is flushed at exit or before an error.
+    std::cout << xerith::to_string(*value) << '\n';
+}
+
+} // extern "C"
@@ -0,0 +1,37 @@
+#ifndef XERITH_AOT_RUNTIME_H
+#define XERITH_AOT_RUNTIME_H
+
+#include <cstdint>
+#include "../runtime/value.h"
+
+/**
+ * @brief C ABI used by ahead-of-time compiled scripts (libxerith_rt).
+ * Generated code treats values as opaque 16-byte, 8-aligned slots; an
+ * all-zero slot is nil. Every function that writes `out` expects it to
+ * hold nil and leaves it owning a reference. Operators are passed as
+ * OpCode values so the ABI shares one numbering with the bytecode VM.
+ * A runtime error prints "Runtime Error: ..." and exits with status 70.
+ */
+extern "C" {
+
+void xrt_globals(uint32_t count);
+void xrt_global_define(uint32_t index, const xerith::Value* value);
+void xrt_global_get(uint32_t index, const char* name, xerith::Value* out);
+void xrt_global_set(uint32_t index, const char* name, const xerith::Value* value);
+
+void xrt_number(xerith::Value* out, double number);
+void xrt_bool(xerith::Value* out, bool boolean);
+void xrt_string(xerith::Value* out, const char* chars, uint64_t length);
+
+void xrt_copy(xerith::Value* out, const xerith::Value* value);
+void xrt_assign(xerith::Value* target, const xerith::Value* value);
+void xrt_release(xerith::Value* value);
+
+void xrt_unary(uint8_t op, xerith::Value* out, const xerith::Value* operand);
+void xrt_binary(uint8_t op, xerith::Value* out, const xerith::Value* left, const xerith::Value* right);
+bool xrt_truthy(const xerith::Value* value);
+void xrt_print(const xerith::Value* value);
+
+} // extern "C"
+
+#endif // XERITH_AOT_RUNTIME_H
@@ -0,0 +1,72 @@
+#include "module_loader.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../sema/constant_folder.h"
+#include "../sema/resolver.h"
+#include "../utils/stats.h"
+
+namespace xerith {
+
+namespace {
+
+void parse_module(Module& module, DiagnosticBuffer& diagnostics) {
+    Diagnostics::capture(&diagnostics);
+    {
+        XERITH_STATS_PHASE(PARSE);
+        Lexer lexer(module.file);
+        Parser parser(lexer, *module.arena);
+        module.statements = parser.parse();
+        module.had_error = parser.had_error();
+    }
+    Diagnostics::capture(nullptr);
+}
+
+} // namespace
+
+ModuleLoader::ModuleLoader(unsigned jobs)
+    : jobs(jobs != 0 ? jobs : std::max(1u, std::thread::hardware_concurrency())) {}
+
+std::vector<Module> ModuleLoader::load(const std::vector<FileId>& files, GlobalTable& globals) {
+    std::vector<Module> modules(files.size());
+    std::vector<DiagnosticBuffer> diagnostics(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        modules[i].file = files[i];
+        modules[i].arena = std::make_unique<Arena>(64 * 1024);
+    }
+
+    // Threads take the next unparsed file until none are left, so one
+    // large file does not hold up the rest.
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < modules.size();) parse_module(modules[i], diagnostics[i]);
+    };
+    size_t thread_count = std::min<size_t>(jobs, modules.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; t++) {
+        threads.emplace_back([&] {
+            work();
+            Stats::merge_thread();
+        });
+    }
+    work();
+    for (std::thread& thread : threads) thread.join();
+
+    for (size_t i = 0; i < modules.size(); i++) {
+        diagnostics[i].flush();
+        Module& module = modules[i];
+        {
+            XERITH_STATS_PHASE(FOLD);
+            ConstantFolder folder(*module.arena);
+            folder.fold(module.statements);
+        }
+        XERITH_STATS_PHASE(RESOLVE);
+        Resolver resolver(globals);
+        resolver.resolve(module.statements);
+    }
+    return modules;
+}
+
+} // namespace xerith
@@ -0,0 +1,49 @@
+#ifndef XERITH_MODULE_LOADER_H
+#define XERITH_MODULE_LOADER_H
+
+#include <memory>
+#include <vector>
+#include "../errors/diagnostics.h"
+#include "../parser/ast.h"
+#include "../sema/symbols.h"
+#include "../utils/arena.h"
+#include "../utils/span.h"
+
+namespace xerith {
+
+/**
+ * @brief One source file after the front end has run over it.
+ * The tree lives in the module's own arena, so it stays valid for as
+ * long as the Module does.
+ */
+struct Module {
+    FileId file = 0;
+    std::unique_ptr<Arena> arena;
+    StmtList statements;
+    bool had_error = false;
+};
+
+/**
+ * @brief Runs the front end over several files at once.
+ * Lexing and parsing, the bulk of the work, happen on a pool of threads,
+ * one file at a time per thread, each into its own arena and its own
+ * DiagnosticBuffer. Folding and resolution then run on the calling thread
+ * in the order the files were given: they intern new strings and number
+ * globals in a table the files share, and doing them in order is what
+ * makes the slots and the diagnostics come out the same on every run.
+ */
+class ModuleLoader {
+public:
+    // `jobs` threads at most; 0 means one per hardware thread.
+    explicit ModuleLoader(unsigned jobs = 0);
+
+    // Files must already be registered with the SourceManager.
+    std::vector<Module> load(const std::vector<FileId>& files, GlobalTable& globals);
+
+private:
+    unsigned jobs;
+};
+
+} // namespace xerith
+
+#endif // XERITH_MODULE_LOADER_H
@@ -1,20 +1,38 @@
 #include "diagnostics.h"
 #include <iostream>
-#include <fstream>
 #include <string>
+#include "../utils/source_manager.h"
 
 namespace xerith {
 
+namespace {
+
+thread_local DiagnosticBuffer* captured = nullptr;
+
+} // namespace
+
+void DiagnosticBuffer::flush() {
+    std::cout << out.str() << std::flush;
+    std::cerr << err.str() << std::flush;
+    out.str("");
+    err.str("");
+}
+
+void Diagnostics::capture(DiagnosticBuffer* buffer) { captured = buffer; }
+
+std::ostream& Diagnostics::out() { return captured != nullptr ? captured->out : std::cout; }
+std::ostream& Diagnostics::err() { return captured != nullptr ? captured->err : std::cerr; }
+
 void Diagnostics::report(const Error& err) {
     // 1. Print the human-readable header we built in error.cpp
     // This uses the format_full_error function from Step 4
-    std::cout << format_full_error(err) << std::endl;
+    out() << format_full_error(err) << std::endl;
 
     // 2. Print the visual source context if the span is valid
-    if (err.location.line > 0) {
+    if (err.location.is_valid()) {
         print_source_line(err.location);
     }
-    std::cout << std::endl; // Extra spacing for readability
+    out() << std::endl; // Extra spacing for readability
 }
 
 void Diagnostics::report_all(const std::vector<Error>& errors) {
@@ -24,27 +42,23 @@ void Diagnostics::report_all(const std::vector<Error>& errors) {
 }
 
 void Diagnostics::print_source_line(const Span& span) {
-    std::ifstream file(span.filename);
-    if (!file.is_open()) return;
-
-    std::string line_text;
-    // Skip lines until we reach the target line
-    for (int i = 1; i <= span.line; ++i) {
-        if (!std::getline(file, line_text)) break;
-    }
+    // Line and column are only worked out here, when an error is shown.
+    LineColumn position = SourceManager::resolve(span);
+    std::string_view line_text = SourceManager::line_text(span.file, position.line);
 
     if (line_text.empty()) return;
 
     // Print the line number and the code
-    std::cout << "  " << span.line << " | " << line_text << std::endl;
+    std::ostream& os = out();
+    os << "  " << position.line << " | " << line_text << std::endl;
 
     // Print the caret pointer
     // We add spaces equal to (line number prefix + current column - 1)
-    std::cout << "    | ";
-    for (int i = 1; i < span.column; ++i) {
-        std::cout << " ";
+    os << "    | ";
+    for (int i = 1; i < position.column; ++i) {
+        os << " ";
     }
-    std::cout << "\033[1;31m^\033[0m" << std::endl; // Bold Red Caret
+    os << "\033[1;31m^\033[0m" << std::endl; // Bold Red Caret
 }
 
 } // namespace xerith
\ No newline at end of file
@@ -2,12 +2,37 @@
 #define XERITH_DIAGNOSTICS_H
 
 #include "error.h"
+#include <ostream>
+#include <sstream>
 #include <vector>
 
 namespace xerith {
 
+/**
+ * @brief Holds one thread's diagnostics until they can be shown in order.
+ * `out` collects what report() prints to stdout and `err` what the parser
+ * prints to stderr.
+ */
+struct DiagnosticBuffer {
+    std::ostringstream out;
+    std::ostringstream err;
+
+    // Writes both to the console and empties them.
+    void flush();
+};
+
 class Diagnostics {
 public:
+    /**
+     * @brief Sends this thread's diagnostics to `buffer` instead of the
+     * console; nullptr switches back.
+     */
+    static void capture(DiagnosticBuffer* buffer);
+
+    // Streams that this thread's diagnostics should be written to.
+    static std::ostream& out();
+    static std::ostream& err();
+
     /**
      * @brief Reports a single error to the console with source context.
      * Includes the file snippet and caret pointing to the column.
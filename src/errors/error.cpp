@@ -1,5 +1,6 @@
 #include "error.h"
 #include <sstream>
+#include "../utils/source_manager.h"
 
 namespace xerith {
 
@@ -31,8 +32,9 @@ std::string format_full_error(const Error& err) {
     ss << color;
     if (!err.code.empty()) ss << "[" << err.code << "] ";
     ss << get_error_name(err.type) << " ";
-    ss << "at " << err.location.filename << ":" 
-       << err.location.line << ":" << err.location.column << ": ";
+    ss << "at ";
+    err.location.print(ss);
+    ss << ": ";
     ss << reset << err.message;
 
     return ss.str();
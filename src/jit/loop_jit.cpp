@@ -0,0 +1,402 @@
+#include "loop_jit.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Scalar/GVN.h>
+#include <llvm/Transforms/Utils.h>
+#include "../utils/logging.h"
+
+namespace xerith {
+
+namespace {
+
+// Compiled loops take the numeric variables they touch as one array.
+using LoopFunction = void (*)(double* cells);
+
+/**
+ * @brief A variable the native loop reads or writes that lives outside it.
+ */
+struct Cell {
+    bool global;
+    int slot;  // GlobalTable index for globals, frame slot for locals
+};
+
+/**
+ * @brief Lowers one WhileStmt to an LLVM function.
+ * Expressions are typed statically as either number (double) or bool (i1);
+ * anything else marks the loop unsupported and lowering stops there.
+ */
+class LoopLowering : public ExprVisitor, public StmtVisitor {
+public:
+    LoopLowering(llvm::LLVMContext& context, llvm::Module& module)
+        : context(context), module(module), builder(context) {}
+
+    // Returns nullptr if the loop uses anything the native tier cannot run.
+    llvm::Function* lower(WhileStmt& loop, const std::string& name) {
+        auto* type = llvm::FunctionType::get(builder.getVoidTy(), {builder.getDoubleTy()->getPointerTo()}, false);
+        function = llvm::Function::Create(type, llvm::Function::ExternalLinkage, name, module);
+        cells_arg = function->getArg(0);
+
+        entry = llvm::BasicBlock::Create(context, "entry", function);
+        auto* body = llvm::BasicBlock::Create(context, "body", function);
+        builder.SetInsertPoint(body);
+        loop.accept(*this);
+        if (!supported) {
+            function->eraseFromParent();
+            return nullptr;
+        }
+
+        // Every cell is loaded once on entry and stored back once on exit;
+        // in between it is an alloca that mem2reg turns into SSA values.
+        for (size_t i = 0; i < cells.size(); i++) builder.CreateStore(builder.CreateLoad(builder.getDoubleTy(), cell_allocas[i]), cell_pointer(i));
+        builder.CreateRetVoid();
+
+        builder.SetInsertPoint(entry);
+        for (size_t i = 0; i < cells.size(); i++) builder.CreateStore(builder.CreateLoad(builder.getDoubleTy(), cell_pointer(i)), cell_allocas[i]);
+        builder.CreateBr(body);
+        return function;
+    }
+
+    std::vector<Cell> cells;
+
+    // Stmt Visitor Methods
+    void visit_print_stmt(PrintStmt&) override { supported = false; }
+    void visit_function_stmt(FunctionStmt&) override { supported = false; }
+    void visit_return_stmt(ReturnStmt&) override { supported = false; }
+
+    void visit_expression_stmt(ExpressionStmt& stmt) override {
+        lower(*stmt.expression);
+    }
+
+    void visit_var_stmt(VarStmt& stmt) override {
+        if (stmt.slot < 0 || stmt.boxed || stmt.initializer == nullptr) {
+            supported = false;
+            return;
+        }
+        llvm::Value* value = lower_number(*stmt.initializer);
+        if (!supported) return;
+        llvm::AllocaInst*& variable = inner_locals[stmt.slot];
+        if (variable == nullptr) variable = make_alloca();
+        builder.CreateStore(value, variable);
+    }
+
+    void visit_block_stmt(BlockStmt& stmt) override {
+        for (Stmt* statement : stmt.statements) {
+            if (!supported) return;
+            statement->accept(*this);
+        }
+    }
+
+    void visit_while_stmt(WhileStmt& stmt) override {
+        auto* header = llvm::BasicBlock::Create(context, "loop", function);
+        auto* body = llvm::BasicBlock::Create(context, "loop.body", function);
+        auto* exit = llvm::BasicBlock::Create(context, "loop.exit", function);
+        builder.CreateBr(header);
+
+        builder.SetInsertPoint(header);
+        llvm::Value* condition = lower_condition(*stmt.condition);
+        if (!supported) return;
+        builder.CreateCondBr(condition, body, exit);
+
+        builder.SetInsertPoint(body);
+        stmt.body->accept(*this);
+        if (!supported) return;
+        builder.CreateBr(header);
+
+        builder.SetInsertPoint(exit);
+    }
+
+    void visit_if_stmt(IfStmt& stmt) override {
+        llvm::Value* condition = lower_condition(*stmt.condition);
+        if (!supported) return;
+        auto* then_block = llvm::BasicBlock::Create(context, "if.then", function);
+        auto* else_block = llvm::BasicBlock::Create(context, "if.else", function);
+        auto* merge = llvm::BasicBlock::Create(context, "if.end", function);
+        builder.CreateCondBr(condition, then_block, else_block);
+
+        builder.SetInsertPoint(then_block);
+        stmt.then_branch->accept(*this);
+        if (!supported) return;
+        builder.CreateBr(merge);
+
+        builder.SetInsertPoint(else_block);
+        if (stmt.else_branch != nullptr) stmt.else_branch->accept(*this);
+        if (!supported) return;
+        builder.CreateBr(merge);
+
+        builder.SetInsertPoint(merge);
+    }
+
+    // Expr Visitor Methods. The returned Value is unused; the lowered
+    // result is left in `result` with its static type in `result_is_number`.
+    Value visit_binary_expr(BinaryExpr& expr) override {
+        llvm::Value* left = lower(*expr.left);
+        bool left_is_number = result_is_number;
+        llvm::Value* right = lower(*expr.right);
+        bool right_is_number = result_is_number;
+        if (!supported) return Value();
+
+        TokenType op = expr.op.type;
+        if (!left_is_number || !right_is_number) {
+            // Only bool == bool and bool != bool make sense without numbers.
+            if (left_is_number == right_is_number && op == TokenType::EQUAL_EQUAL) set_bool(builder.CreateICmpEQ(left, right));
+            else if (left_is_number == right_is_number && op == TokenType::BANG_EQUAL) set_bool(builder.CreateICmpNE(left, right));
+            else supported = false;
+            return Value();
+        }
+
+        // Ordered compares match C++ semantics for NaN; != is its negation.
+        switch (op) {
+            case TokenType::PLUS:          set_number(builder.CreateFAdd(left, right)); break;
+            case TokenType::MINUS:         set_number(builder.CreateFSub(left, right)); break;
+            case TokenType::STAR:          set_number(builder.CreateFMul(left, right)); break;
+            case TokenType::SLASH:         set_number(builder.CreateFDiv(left, right)); break;
+            case TokenType::GREATER:       set_bool(builder.CreateFCmpOGT(left, right)); break;
+            case TokenType::GREATER_EQUAL: set_bool(builder.CreateFCmpOGE(left, right)); break;
+            case TokenType::LESS:          set_bool(builder.CreateFCmpOLT(left, right)); break;
+            case TokenType::LESS_EQUAL:    set_bool(builder.CreateFCmpOLE(left, right)); break;
+            case TokenType::EQUAL_EQUAL:   set_bool(builder.CreateFCmpOEQ(left, right)); break;
+            case TokenType::BANG_EQUAL:    set_bool(builder.CreateFCmpUNE(left, right)); break;
+            default:                       supported = false; break;
+        }
+        return Value();
+    }
+
+    Value visit_unary_expr(UnaryExpr& expr) override {
+        if (expr.op.type == TokenType::BANG) {
+            llvm::Value* condition = lower_condition(*expr.right);
+            if (supported) set_bool(builder.CreateNot(condition));
+            return Value();
+        }
+        llvm::Value* operand = lower_number(*expr.right);
+        if (supported && expr.op.type == TokenType::MINUS) set_number(builder.CreateFNeg(operand));
+        else supported = false;
+        return Value();
+    }
+
+    Value visit_literal_expr(LiteralExpr& expr) override {
+        const Value& constant = expr.constant;
+        if (constant.is_number()) set_number(llvm::ConstantFP::get(builder.getDoubleTy(), constant.as_number()));
+        else if (constant.is_bool()) set_bool(builder.getInt1(constant.as_bool()));
+        else supported = false;
+        return Value();
+    }
+
+    Value visit_grouping_expr(GroupingExpr& expr) override {
+        lower(*expr.expression);
+        return Value();
+    }
+
+    Value visit_variable_expr(VariableExpr& expr) override {
+        if (!plain(expr.target)) return Value();
+        llvm::AllocaInst* variable = variable_for(expr.target);
+        set_number(builder.CreateLoad(builder.getDoubleTy(), variable));
+        return Value();
+    }
+
+    Value visit_assign_expr(AssignExpr& expr) override {
+        llvm::Value* value = lower_number(*expr.value);
+        if (!supported || !plain(expr.target)) return Value();
+        builder.CreateStore(value, variable_for(expr.target));
+        set_number(value);
+        return Value();
+    }
+
+    Value visit_call_expr(CallExpr&) override {
+        supported = false;
+        return Value();
+    }
+
+private:
+    llvm::Value* lower(Expr& expr) {
+        if (!supported) return nullptr;
+        expr.accept(*this);
+        return result;
+    }
+
+    // Every variable is a number, so only number-valued stores are allowed.
+    llvm::Value* lower_number(Expr& expr) {
+        llvm::Value* value = lower(expr);
+        if (supported && !result_is_number) supported = false;
+        return value;
+    }
+
+    // Truthiness: numbers are always true.
+    llvm::Value* lower_condition(Expr& expr) {
+        llvm::Value* value = lower(expr);
+        if (!supported) return nullptr;
+        return result_is_number ? builder.getTrue() : value;
+    }
+
+    void set_number(llvm::Value* value) { result = value; result_is_number = true; }
+    void set_bool(llvm::Value* value) { result = value; result_is_number = false; }
+
+    llvm::AllocaInst* make_alloca() {
+        llvm::IRBuilder<> entry_builder(entry, entry->begin());
+        return entry_builder.CreateAlloca(builder.getDoubleTy());
+    }
+
+    llvm::Value* cell_pointer(size_t index) {
+        return builder.CreateConstInBoundsGEP1_64(builder.getDoubleTy(), cells_arg, index);
+    }
+
+    // Captured variables live in boxes the native code cannot see.
+    bool plain(const SymbolRef& target) {
+        if (target.is_upvalue() || (!target.is_global() && target.boxed)) supported = false;
+        return supported;
+    }
+
+    llvm::AllocaInst* variable_for(const SymbolRef& target) {
+        if (!target.is_global()) {
+            auto inner = inner_locals.find(target.slot);
+            if (inner != inner_locals.end()) return inner->second;
+        }
+
+        auto& index = target.is_global() ? global_cells[target.global] : local_cells[target.slot];
+        if (index == 0) {
+            cells.push_back(Cell{target.is_global(), target.is_global() ? target.global : target.slot});
+            cell_allocas.push_back(make_alloca());
+            index = cells.size();
+        }
+        return cell_allocas[index - 1];
+    }
+
+    llvm::LLVMContext& context;
+    llvm::Module& module;
+    llvm::IRBuilder<> builder;
+    llvm::Function* function = nullptr;
+    llvm::Value* cells_arg = nullptr;
+    llvm::BasicBlock* entry = nullptr;
+
+    llvm::Value* result = nullptr;
+    bool result_is_number = false;
+    bool supported = true;
+
+    // Cell indices are stored 1-based so a fresh map entry reads as "none".
+    std::unordered_map<int, size_t> global_cells;
+    std::unordered_map<int, size_t> local_cells;
+    std::vector<llvm::AllocaInst*> cell_allocas;
+    // Locals declared inside the loop never leave native code.
+    std::unordered_map<int, llvm::AllocaInst*> inner_locals;
+};
+
+void optimize(llvm::Module& module, llvm::Function& function) {
+    llvm::legacy::FunctionPassManager passes(&module);
+    passes.add(llvm::createPromoteMemoryToRegisterPass());
+    passes.add(llvm::createInstructionCombiningPass());
+    passes.add(llvm::createGVNPass());
+    passes.add(llvm::createCFGSimplificationPass());
+    passes.doInitialization();
+    passes.run(function);
+    passes.doFinalization();
+}
+
+} // namespace
+
+struct LoopJit::Impl {
+    struct Entry {
+        LoopFunction function = nullptr;  // nullptr: the loop cannot be compiled
+        std::vector<Cell> cells;
+        llvm::orc::ResourceTrackerSP tracker;  // owns the loop's module and code
+    };
+
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    llvm::orc::ThreadSafeContext context{std::make_unique<llvm::LLVMContext>()};
+    std::unordered_map<const WhileStmt*, Entry> entries;
+    std::vector<double> scratch;
+    size_t compiled = 0;
+
+    Impl() {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        auto created = llvm::orc::LLJITBuilder().create();
+        if (!created) {
+            Logger::warn("JIT unavailable: " + llvm::toString(created.takeError()));
+            return;
+        }
+        jit = std::move(*created);
+    }
+
+    Entry compile(WhileStmt& loop) {
+        Entry entry;
+        std::string name = "xerith_loop_" + std::to_string(compiled++);
+        auto module = std::make_unique<llvm::Module>(name, *context.getContext());
+        module->setDataLayout(jit->getDataLayout());
+
+        LoopLowering lowering(*context.getContext(), *module);
+        llvm::Function* function = lowering.lower(loop, name);
+        if (function == nullptr) return entry;
+        if (llvm::verifyFunction(*function, &llvm::errs())) return entry;
+        optimize(*module, *function);
+
+        auto tracker = jit->getMainJITDylib().createResourceTracker();
+        if (auto error = jit->addIRModule(tracker, llvm::orc::ThreadSafeModule(std::move(module), context))) {
+            Logger::warn("JIT failed: " + llvm::toString(std::move(error)));
+            return entry;
+        }
+        auto symbol = jit->lookup(name);
+        if (!symbol) {
+            Logger::warn("JIT failed: " + llvm::toString(symbol.takeError()));
+            release(tracker);
+            return entry;
+        }
+        entry.function = reinterpret_cast<LoopFunction>(symbol->getAddress());
+        entry.tracker = std::move(tracker);
+        entry.cells = std::move(lowering.cells);
+        return entry;
+    }
+
+    // Frees a module's native code and IR.
+    static void release(const llvm::orc::ResourceTrackerSP& tracker) {
+        if (auto error = tracker->remove()) Logger::warn("JIT failed: " + llvm::toString(std::move(error)));
+    }
+};
+
+LoopJit::LoopJit() : impl(std::make_unique<Impl>()) {}
+LoopJit::~LoopJit() = default;
+
+bool LoopJit::available() const { return impl->jit != nullptr; }
+
+bool LoopJit::run(WhileStmt& loop, Globals& globals, ValueStack& locals) {
+    if (!available()) return false;
+
+    auto it = impl->entries.find(&loop);
+    if (it == impl->entries.end()) it = impl->entries.emplace(&loop, impl->compile(loop)).first;
+    const Impl::Entry& entry = it->second;
+    if (entry.function == nullptr) return false;
+
+    // Type guard: the native code assumes every cell holds a number.
+    std::vector<Value*> values;
+    values.reserve(entry.cells.size());
+    for (const Cell& cell : entry.cells) {
+        Value* value = cell.global ? globals.find(cell.slot) : &locals.at(cell.slot);
+        if (value == nullptr || !value->is_number()) return false;
+        values.push_back(value);
+    }
+
+    std::vector<double>& numbers = impl->scratch;
+    numbers.resize(values.size());
+    for (size_t i = 0; i < values.size(); i++) numbers[i] = values[i]->as_number();
+    entry.function(numbers.data());
+    for (size_t i = 0; i < values.size(); i++) *values[i] = numbers[i];
+    return true;
+}
+
+void LoopJit::forget_loops() {
+    for (auto& [loop, entry] : impl->entries) {
+        if (entry.tracker) Impl::release(entry.tracker);
+    }
+    impl->entries.clear();
+}
+
+} // namespace xerith
@@ -0,0 +1,51 @@
+#ifndef XERITH_LOOP_JIT_H
+#define XERITH_LOOP_JIT_H
+
+#include <cstdint>
+#include <memory>
+#include "../parser/ast.h"
+#include "../runtime/environment.h"
+
+namespace xerith {
+
+/**
+ * @brief Native tier for hot, purely numeric `while` loops.
+ * The Interpreter hands a loop over once it has run HOT_ITERATIONS times
+ * in a row. If every statement in the loop only reads and writes numbers
+ * (no print, strings, nil or bool-valued variables) the whole loop is
+ * lowered to LLVM IR and compiled through ORC; the result is cached per
+ * WhileStmt. Before each native run the variables it touches are checked
+ * to still hold numbers. On any mismatch run() returns false and the
+ * Interpreter simply keeps going, so semantics never depend on the JIT.
+ * LLVM types stay behind the Impl so including this header is cheap.
+ */
+class LoopJit {
+public:
+    static constexpr uint32_t HOT_ITERATIONS = 4096;
+
+    LoopJit();
+    ~LoopJit();
+
+    // False if LLVM could not set up a JIT for the host.
+    bool available() const;
+
+    // Runs the rest of `loop` natively, starting at its condition check.
+    // Returns false, having changed nothing, if the loop cannot be compiled
+    // or the current variable types do not match the compiled code.
+    bool run(WhileStmt& loop, Globals& globals, ValueStack& locals);
+
+    // Drops every cached loop and frees its native code. Entries are keyed
+    // on node addresses, which a caller that frees or reuses its tree may
+    // hand out again, so the Interpreter forgets them before each run. A
+    // REPL keeps its trees; there this only recompiles loops that get hot
+    // again, and memory stays bounded by the loops of a single input.
+    void forget_loops();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace xerith
+
+#endif // XERITH_LOOP_JIT_H
@@ -1,36 +1,98 @@
 #include "lexer.h"
+#include "scan.h"
 #include "../errors/diagnostics.h"
-#include <unordered_map>
+#include "../utils/source_manager.h"
+#include "../runtime/value.h"
+#include "../utils/stats.h"
+#include <array>
+#include <cstdint>
 
 namespace xerith {
 
-static const std::unordered_map<std::string, TokenType> keywords = {
-    {"and",    TokenType::AND},
-    {"class",  TokenType::CLASS},
-    {"else",   TokenType::ELSE},
-    {"false",  TokenType::FALSE},
-    {"fn",     TokenType::FN},
-    {"fun",    TokenType::FUN},
-    {"for",    TokenType::FOR},
-    {"if",     TokenType::IF},
-    {"nil",    TokenType::NIL},
-    {"or",     TokenType::OR},
-    {"return", TokenType::RETURN},
-    {"let",    TokenType::LET},
-    {"while",  TokenType::WHILE},
-    {"print",  TokenType::PRINT},
+namespace {
+
+// Character classes, indexed by the unsigned byte. Unlike <cctype> this
+// ignores the locale and is a single load.
+enum CharClass : uint8_t {
+    DIGIT = 1 << 0,
+    ALPHA = 1 << 1,  // letters and '_', which can start an identifier
 };
 
-Lexer::Lexer(std::string source, std::string filename) 
-    : source(std::move(source)), filename(std::move(filename)) {}
+constexpr std::array<uint8_t, 256> make_char_classes() {
+    std::array<uint8_t, 256> classes = {};
+    for (int c = '0'; c <= '9'; c++) classes[c] = DIGIT;
+    for (int c = 'a'; c <= 'z'; c++) classes[c] = ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++) classes[c] = ALPHA;
+    classes['_'] = ALPHA;
+    return classes;
+}
 
-std::vector<Token> Lexer::scan_tokens() {
-    while (!is_at_end()) {
+constexpr std::array<uint8_t, 256> CHAR_CLASSES = make_char_classes();
+
+constexpr bool is_digit(char c) { return CHAR_CLASSES[static_cast<uint8_t>(c)] & DIGIT; }
+constexpr bool is_alpha(char c) { return CHAR_CLASSES[static_cast<uint8_t>(c)] & ALPHA; }
+constexpr bool is_alnum(char c) { return CHAR_CLASSES[static_cast<uint8_t>(c)] & (DIGIT | ALPHA); }
+
+// Keywords are recognised by first character and length, so an ordinary
+// identifier costs at most one short compare and nothing is hashed.
+TokenType keyword_type(std::string_view text) {
+    auto word = [&](std::string_view keyword, TokenType type) {
+        return text == keyword ? type : TokenType::IDENTIFIER;
+    };
+    switch (text[0]) {
+        case 'a': return word("and", TokenType::AND);
+        case 'c': return word("class", TokenType::CLASS);
+        case 'e': return word("else", TokenType::ELSE);
+        case 'f':
+            switch (text.size()) {
+                case 2: return word("fn", TokenType::FN);
+                case 3: return text[1] == 'o' ? word("for", TokenType::FOR) : word("fun", TokenType::FUN);
+                case 5: return word("false", TokenType::FALSE);
+            }
+            break;
+        case 'i': return word("if", TokenType::IF);
+        case 'l': return word("let", TokenType::LET);
+        case 'n': return word("nil", TokenType::NIL);
+        case 'o': return word("or", TokenType::OR);
+        case 'p': return word("print", TokenType::PRINT);
+        case 'r': return word("return", TokenType::RETURN);
+        case 's': return word("super", TokenType::SUPER);
+        case 't':
+            if (text.size() == 4) return text[1] == 'h' ? word("this", TokenType::THIS) : word("true", TokenType::TRUE);
+            break;
+        case 'w': return word("while", TokenType::WHILE);
+    }
+    return TokenType::IDENTIFIER;
+}
+
+} // namespace
+
+Lexer::Lexer(FileId file) : source(SourceManager::text(file)), file(file) {}
+
+Token Lexer::next_token() {
+    XERITH_STATS_PHASE(LEX);
+    const char* end = source.data() + source.size();
+    for (;;) {
+        // Whitespace never forms a token, so it is skipped in bulk here.
+        current = static_cast<int>(skip_whitespace(source.data() + current, end) - source.data());
+        if (is_at_end()) break;
         start = current;
         scan_token();
+        if (pending) {
+            XERITH_STATS_COUNT(TOKENS, 1);
+            Token token = *pending;
+            pending.reset();
+            return token;
+        }
     }
+    return Token(TokenType::END_OF_FILE, "", Span(file, current));
+}
 
-    tokens.emplace_back(TokenType::END_OF_FILE, "", Span(filename, line, column));
+std::vector<Token> Lexer::scan_tokens() {
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(next_token());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
     return tokens;
 }
 
@@ -56,80 +118,69 @@ void Lexer::scan_token() {
         case '/':
             if (match('/')) {
                 // A comment goes until the end of the line.
-                while (peek() != '\n' && !is_at_end()) advance();
+                current = offset_of_next('\n');
             } else {
                 add_token(TokenType::SLASH);
             }
             break;
 
-        case ' ':
-        case '\r':
-        case '\t':
-            break;
-
-        case '\n':
-            line++;
-            column = 1;
-            break;
-
         case '"': string(); break;
 
         default:
-            if (isdigit(c)) {
+            if (is_digit(c)) {
                 number();
-            } else if (isalpha(c) || c == '_') {
+            } else if (is_alpha(c)) {
                 identifier();
             } else {
-                Diagnostics::report(Error(
-                    ErrorType::Lexical,
-                    Severity::Error,
-                    Span(filename, line, column - 1),
-                    "Unexpected character: " + std::string(1, c)
-                ));
+                report(current - 1, "Unexpected character: " + std::string(1, c));
             }
             break;
     }
 }
 
 void Lexer::string() {
-    while (peek() != '"' && !is_at_end()) {
-        if (peek() == '\n') { line++; column = 1; }
-        advance();
-    }
+    // Strings have no escapes and may span lines, so the body ends at the next quote.
+    current = offset_of_next('"');
 
     if (is_at_end()) {
-        Diagnostics::report(Error(ErrorType::Lexical, Severity::Error, 
-            Span(filename, line, column), "Unterminated string."));
+        report(start, "Unterminated string.");
         return;
     }
 
     // The closing ".
     advance(); 
 
-    std::string value = source.substr(start + 1, current - start - 2);
-    tokens.emplace_back(TokenType::STRING, value, Span(filename, line, column - (current - start)));
+    std::string_view value = source.substr(start + 1, current - start - 2);
+    pending.emplace(TokenType::STRING, value, Span(file, start), intern_pinned(value));
 }
 
 void Lexer::number() {
-    while (isdigit(peek())) advance();
+    while (is_digit(peek())) advance();
 
-     if (peek() == '.' && isdigit(peek_next())) {
+     if (peek() == '.' && is_digit(peek_next())) {
         // Consume the "."
         advance();
-        while (isdigit(peek())) advance();
+        while (is_digit(peek())) advance();
     }
 
     add_token(TokenType::NUMBER);
 }
 
 void Lexer::identifier() {
-    while (isalnum(peek()) || peek() == '_') advance();
+    while (is_alnum(peek())) advance();
 
-    std::string text = source.substr(start, current - start);
-    auto it = keywords.find(text);
-    TokenType type = (it != keywords.end()) ? it->second : TokenType::IDENTIFIER;
+    std::string_view text = source.substr(start, current - start);
+    TokenType type = keyword_type(text);
+    if (type != TokenType::IDENTIFIER) {
+        add_token(type);
+        return;
+    }
+    pending.emplace(TokenType::IDENTIFIER, text, Span(file, start), intern_pinned(text));
+}
 
-    add_token(type); 
+int Lexer::offset_of_next(char c) const {
+    const char* end = source.data() + source.size();
+    return static_cast<int>(find_char(source.data() + current, end, c) - source.data());
 }
 
 bool Lexer::is_at_end() const {
@@ -137,7 +188,6 @@ bool Lexer::is_at_end() const {
 }
 
 char Lexer::advance() {
-    column++;
     return source[current++];
 }
 
@@ -156,13 +206,15 @@ bool Lexer::match(char expected) {
     if (source[current] != expected) return false;
 
     current++;
-    column++;
     return true;
 }
 
 void Lexer::add_token(TokenType type) {
-    std::string text = source.substr(start, current - start);
-    tokens.emplace_back(type, text, Span(filename, line, column - (current - start)));
+    pending.emplace(type, source.substr(start, current - start), Span(file, start));
+}
+
+void Lexer::report(int offset, const std::string& message) {
+    Diagnostics::report(Error(ErrorType::Lexical, Severity::Error, Span(file, offset), message));
 }
 
 } // namespace xerith
\ No newline at end of file
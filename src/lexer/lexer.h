@@ -2,6 +2,8 @@
 #define XERITH_LEXER_H
 
 #include <string>
+#include <optional>
+#include <string_view>
 #include <vector>
 #include "token.h"
 
@@ -9,9 +11,14 @@ namespace xerith {
 
 class Lexer {
 public:
-    Lexer(std::string source, std::string filename);
-    
+    // Scans a file previously registered with the SourceManager.
+    explicit Lexer(FileId file);
 
+    // Scans just far enough to produce the next token. Returns END_OF_FILE
+    // once the input is exhausted, and keeps returning it.
+    Token next_token();
+
+    // Convenience wrapper that drains next_token() into a vector.
     std::vector<Token> scan_tokens();
 
 private:
@@ -20,21 +27,25 @@ private:
     void number();
     void string();
 
+    // Offset of the next `c` at or after `current`; the source size if none.
+    int offset_of_next(char c) const;
+
     bool is_at_end() const;
     char advance();
     char peek() const;
     char peek_next() const;
     bool match(char expected);
     void add_token(TokenType type);
+    void report(int offset, const std::string& message);
 
-    std::string source;
-    std::string filename;
-    std::vector<Token> tokens;
+    std::string_view source;
+    FileId file;
+    // Set by add_token while scan_token runs; whitespace and comments
+    // leave it empty.
+    std::optional<Token> pending;
 
     int start = 0;
     int current = 0;
-    int line = 1;
-    int column = 1;
 };
 
 } // namespace xerith
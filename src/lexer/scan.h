@@ -0,0 +1,59 @@
+#ifndef XERITH_SCAN_H
+#define XERITH_SCAN_H
+
+// Byte-run scanners for the lexer. On x86-64 (where SSE2 is baseline)
+// they test 16 bytes per step; elsewhere, and for the last few bytes of
+// a buffer, they fall back to a plain loop. Loads never go past `end`,
+// so they are safe on memory-mapped files.
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define XERITH_SCAN_SSE2 1
+#else
+#define XERITH_SCAN_SSE2 0
+#endif
+
+namespace xerith {
+
+constexpr bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// First byte in [p, end) that is not whitespace; `end` if there is none.
+inline const char* skip_whitespace(const char* p, const char* end) {
+    // Most runs are a single space, so look at one byte before going wide.
+    if (p == end || !is_space(*p)) return p;
+#if XERITH_SCAN_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, tab)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(bytes, cr), _mm_cmpeq_epi8(bytes, newline)));
+        unsigned other = ~static_cast<unsigned>(_mm_movemask_epi8(blank)) & 0xFFFF;
+        if (other != 0) return p + __builtin_ctz(other);
+        p += 16;
+    }
+#endif
+    while (p != end && is_space(*p)) p++;
+    return p;
+}
+
+// First `c` in [p, end); `end` if there is none.
+inline const char* find_char(const char* p, const char* end, char c) {
+#if XERITH_SCAN_SSE2
+    const __m128i target = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned hits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, target)));
+        if (hits != 0) return p + __builtin_ctz(hits);
+        p += 16;
+    }
+#endif
+    while (p != end && *p != c) p++;
+    return p;
+}
+
+} // namespace xerith
+
+#endif // XERITH_SCAN_H
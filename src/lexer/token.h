@@ -2,10 +2,13 @@
 #define XERITH_TOKEN_H
 
 #include <string>
+#include <string_view>
 #include "../errors/diagnostics.h" 
 
 namespace xerith {
 
+struct ObjString;
+
 enum class TokenType {
     LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE,
     COMMA, DOT, MINUS, PLUS, SEMICOLON, SLASH, STAR,
@@ -17,13 +20,21 @@ enum class TokenType {
     END_OF_FILE
 };
 
+/**
+ * @brief A lexeme and where it came from.
+ * `lexeme` views the SourceManager's copy of the file (for strings, the
+ * text between the quotes), so tokens are small and never allocate.
+ */
 struct Token {
     TokenType type;
-    std::string lexeme;
-    Span span; 
+    std::string_view lexeme;
+    Span span;
+    // Interned text of IDENTIFIER and STRING tokens, so names and literals
+    // compare by pointer from here on. Pinned, so it never dangles.
+    ObjString* interned = nullptr;
 
-    Token(TokenType type, std::string lexeme, Span span)
-        : type(type), lexeme(std::move(lexeme)), span(std::move(span)) {}
+    Token(TokenType type, std::string_view lexeme, Span span, ObjString* interned = nullptr)
+        : type(type), lexeme(lexeme), span(span), interned(interned) {}
 };
 
 } // namespace xerith
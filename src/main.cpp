@@ -1,35 +1,297 @@
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <memory>
+#include <new>
+#include <string>
 #include <vector>
+#include "utils/logging.h"
+#include "utils/source_manager.h"
+#include "utils/stats.h"
+#include "aot/aot_compiler.h"
+#include "driver/module_loader.h"
 #include "lexer/lexer.h"
 #include "parser/parser.h"
+#include "parser/ast_printer.h"
+#include "sema/constant_folder.h"
+#include "sema/resolver.h"
+#include "repl/repl_session.h"
+#include "runtime/heap.h"
 #include "runtime/interpreter.h"
+#include "runtime/profiler.h"
+#include "vm/chunk_cache.h"
+#include "vm/compiler.h"
+#include "vm/disasm.h"
+#include "vm/vm.h"
 
 using namespace xerith;
 
-void run(const std::string& source, const std::string& filename, Interpreter& interpreter) {
-    Lexer lexer(source, filename);
-    std::vector<Token> tokens = lexer.scan_tokens();
+#if XERITH_ENABLE_STATS
+// Counted here rather than in xerith_core so the benchmarks can install
+// their own replacements.
+void* operator new(size_t size) {
+    XERITH_STATS_COUNT(ALLOCATIONS, 1);
+    if (void* ptr = std::malloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+#endif
 
-    Parser parser(tokens);
-    std::vector<std::unique_ptr<Stmt>> statements = parser.parse();
+struct Options {
+    bool use_vm = false;   // --vm: run through the bytecode VM
+    bool disasm = false;   // --disasm: dump compiled bytecode before running
+    bool dump_ast = false; // --dump-ast: print the tree before and after folding
+    bool jit = false;      // --jit: compile hot numeric loops to native code
+    bool cache = true;     // --no-cache: always recompile scripts run on the VM
+    bool profile = false;  // --profile: sample the running program, report at exit
+    bool stats = false;    // --stats[=json]: phase times and counters at exit
+    bool stats_json = false;
+    unsigned jobs = 0;     // --jobs N: front-end threads for several scripts; 0 = all cores
+    size_t heap_limit = 0;   // --heap-limit N: most the live objects may take; 0 = no limit
+    size_t gc_threshold = Heap::DEFAULT_THRESHOLD;  // --gc-threshold N: allocation between collections
+    const char* script = nullptr;
+    // Further scripts on the command line. They are loaded together with
+    // `script` and run after it, in order, as one program.
+    std::vector<const char*> more_scripts;
+};
 
-    interpreter.interpret(statements);
+// "64M" and the like: a byte count with an optional K, M or G suffix.
+// Returns false if `text` is not one.
+bool parse_size(const char* text, size_t* bytes) {
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (end == text) return false;
+    switch (*end) {
+        case 'K': case 'k': value <<= 10; end++; break;
+        case 'M': case 'm': value <<= 20; end++; break;
+        case 'G': case 'g': value <<= 30; end++; break;
+        default: break;
+    }
+    if (*end != '\0') return false;
+    *bytes = static_cast<size_t>(value);
+    return true;
 }
 
-int main(int argc, char* argv[]) {
+struct Engines {
     Interpreter interpreter;
-    if (argc > 1) {
-        std::ifstream file(argv[1]);
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        run(buffer.str(), argv[1], interpreter);
+    VM vm;
+};
+
+// Parses, folds and resolves `file`. The tree is allocated in `arena`
+// and globals are numbered in `globals`.
+StmtList analyze(FileId file, Arena& arena, GlobalTable& globals, const Options& options,
+                 bool* had_error = nullptr) {
+    // The parser pulls tokens one at a time; no token buffer is built.
+    Lexer lexer(file);
+    Parser parser(lexer, arena);
+    StmtList statements;
+    {
+        XERITH_STATS_PHASE(PARSE);
+        statements = parser.parse();
+    }
+    if (had_error != nullptr) *had_error = parser.had_error();
+
+    ASTPrinter printer;
+    if (options.dump_ast) std::cout << "== parsed ==\n" << printer.print(statements);
+    {
+        XERITH_STATS_PHASE(FOLD);
+        ConstantFolder folder(arena);
+        folder.fold(statements);
+    }
+    if (options.dump_ast) std::cout << "== folded ==\n" << printer.print(statements);
+
+    XERITH_STATS_PHASE(RESOLVE);
+    Resolver resolver(globals);
+    resolver.resolve(statements);
+    return statements;
+}
+
+bool run_chunk(const Chunk& chunk, FileId file, Engines& engines, const Options& options) {
+    if (options.disasm) disassemble_chunk(chunk, SourceManager::name(file));
+    XERITH_STATS_PHASE(EXECUTE);
+    return engines.vm.interpret(chunk) == InterpretResult::OK;
+}
+
+// Runs an analysed tree on the selected engine. Returns false on a
+// compile or runtime error. A non-empty `cache_file` receives the chunk.
+bool execute(const StmtList& statements, FileId file, Engines& engines, const Options& options,
+             const std::string& cache_file = "") {
+    if (!options.use_vm) {
+        XERITH_STATS_PHASE(EXECUTE);
+        return engines.interpreter.interpret(statements);
+    }
+
+    Chunk chunk;
+    {
+        XERITH_STATS_PHASE(COMPILE);
+        Compiler compiler;
+        if (!compiler.compile(statements, chunk)) return false;
+    }
+    if (!cache_file.empty()) save_cached_chunk(cache_file, file, chunk);
+    return run_chunk(chunk, file, engines, options);
+}
+
+// The tree is allocated in `arena` and must outlive the run: the REPL
+// passes its session arena so earlier inputs stay valid. `cache_file`
+// is where the VM keeps this file's compiled chunk; empty means no
+// caching (the REPL, the tree-walker, or --no-cache).
+void run(FileId file, Arena& arena, GlobalTable& globals, Engines& engines, const Options& options,
+         const std::string& cache_file = "") {
+    if (!cache_file.empty()) {
+        Chunk chunk;
+        if (load_cached_chunk(cache_file, file, chunk)) {
+            run_chunk(chunk, file, engines, options);
+            return;
+        }
+    }
+    bool had_error = false;
+    StmtList statements = analyze(file, arena, globals, options, &had_error);
+    // Scripts with syntax errors are recompiled so the errors show again.
+    execute(statements, file, engines, options, had_error ? "" : cache_file);
+}
+
+// Loads every script through the ModuleLoader, then runs them in order
+// as one program sharing globals. Stops at the first failing script.
+int run_scripts(const std::vector<const char*>& paths, Engines& engines, const Options& options) {
+    std::vector<FileId> files;
+    for (const char* path : paths) {
+        FileId file = SourceManager::load(path);
+        if (file == 0) {
+            std::cerr << "Could not open file '" << path << "'." << std::endl;
+            return 66;
+        }
+        files.push_back(file);
+    }
+
+    GlobalTable globals;
+    ModuleLoader loader(options.jobs);
+    std::vector<Module> modules = loader.load(files, globals);
+    ASTPrinter printer;
+    for (const Module& module : modules) {
+        if (options.dump_ast) {
+            std::cout << "== " << SourceManager::name(module.file) << " ==\n" << printer.print(module.statements);
+        }
+        if (!execute(module.statements, module.file, engines, options)) break;
+    }
+    return 0;
+}
+
+int build_usage() {
+    std::cerr << "Usage: xerith build [--dump-ast] script [-o output.o]" << std::endl;
+    return 64;
+}
+
+// xerith build script.xrth [-o out.o]
+int build(int argc, char* argv[]) {
+    Options options;
+    std::string output;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else if (arg == "--dump-ast") options.dump_ast = true;
+        else if (options.script == nullptr) options.script = argv[i];
+        else return build_usage();
+    }
+    if (options.script == nullptr) return build_usage();
+    if (output.empty()) {
+        output = options.script;
+        size_t dot = output.rfind('.');
+        if (dot != std::string::npos && output.find('/', dot) == std::string::npos) output.resize(dot);
+        output += ".o";
+    }
+
+    FileId file = SourceManager::load(options.script);
+    if (file == 0) {
+        std::cerr << "Could not open file '" << options.script << "'." << std::endl;
+        return 66;
+    }
+
+    Arena arena;
+    GlobalTable globals;
+    bool had_error = false;
+    StmtList statements = analyze(file, arena, globals, options, &had_error);
+    if (had_error) return 65;
+    AotCompiler compiler;
+    return compiler.compile(statements, SourceManager::name(file), output) ? 0 : 65;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "build") return build(argc, argv);
+
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--vm") options.use_vm = true;
+        else if (arg == "--disasm") options.use_vm = options.disasm = true;
+        else if (arg == "--dump-ast") options.dump_ast = true;
+        else if (arg == "--jit") options.jit = true;
+        else if (arg == "--no-cache") options.cache = false;
+        else if (arg == "--profile") options.profile = true;
+        else if (arg == "--stats") options.stats = true;
+        else if (arg == "--stats=json") options.stats = options.stats_json = true;
+        else if (arg == "--jobs" && i + 1 < argc) options.jobs = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--heap-limit" && i + 1 < argc && parse_size(argv[i + 1], &options.heap_limit)) i++;
+        else if (arg == "--gc-threshold" && i + 1 < argc && parse_size(argv[i + 1], &options.gc_threshold)) i++;
+        else if (arg.compare(0, 2, "--") != 0 && options.script == nullptr) options.script = argv[i];
+        else if (arg.compare(0, 2, "--") != 0) options.more_scripts.push_back(argv[i]);
+        else {
+            std::cerr << "Usage: xerith [--vm] [--disasm] [--dump-ast] [--jit] [--no-cache] [--profile] [--stats[=json]]\n"
+                         "              [--jobs N] [--heap-limit N[K|M|G]] [--gc-threshold N[K|M|G]]\n"
+                         "              [script [more scripts...]]\n"
+                         "       xerith build [--dump-ast] script [-o output.o]" << std::endl;
+            return 64;
+        }
+    }
+
+    if (options.stats) {
+        if (XERITH_ENABLE_STATS) Stats::enable();
+        else Logger::warn("--stats: this build was configured with XERITH_ENABLE_STATS=OFF.");
+    }
+
+    Heap::set_threshold(options.gc_threshold);
+    Heap::set_limit(options.heap_limit);
+    Engines engines;
+    if (options.jit) engines.interpreter.enable_jit();
+    std::unique_ptr<Profiler> profiler;
+    if (options.profile) {
+        profiler = std::make_unique<Profiler>();
+        engines.interpreter.set_profiler(profiler.get());
+        engines.vm.set_profiler(profiler.get());
+        profiler->start();
+    }
+    int status = 0;
+    if (!options.more_scripts.empty()) {
+        std::vector<const char*> paths{options.script};
+        paths.insert(paths.end(), options.more_scripts.begin(), options.more_scripts.end());
+        status = run_scripts(paths, engines, options);
+    } else if (options.script != nullptr) {
+        FileId file = SourceManager::load(options.script);
+        if (file == 0) {
+            std::cerr << "Could not open file '" << options.script << "'." << std::endl;
+            return 66;
+        }
+        // --dump-ast needs the tree, so it always takes the full front end.
+        bool cached = options.use_vm && options.cache && !options.dump_ast;
+        Arena arena;
+        GlobalTable globals;
+        run(file, arena, globals, engines, options, cached ? cache_path(options.script) : "");
     } else {
+        ReplSession session;
         std::string line;
-        while (std::cout << "> " && std::getline(std::cin, line)) {
-            run(line, "repl", interpreter);
+        while (std::cout << (session.has_pending() ? "... " : "> ") && std::getline(std::cin, line)) {
+            if (!session.add_line(line)) continue;
+            run(session.take_input(), session.arena(), session.globals(), engines, options);
         }
     }
-    return 0;
-}
\ No newline at end of file
+
+    if (profiler) {
+        profiler->stop();
+        profiler->report(std::cerr);
+        std::string folded = std::string(options.script != nullptr ? options.script : "repl") + ".folded";
+        if (profiler->write_folded(folded)) std::cerr << "Folded stacks written to '" << folded << "'." << std::endl;
+        else std::cerr << "Could not write '" << folded << "'." << std::endl;
+    }
+    if (Stats::enabled()) Logger::stats(options.stats_json);
+    return status;
+}
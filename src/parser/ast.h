@@ -1,147 +1,227 @@
 #ifndef XERITH_AST_H
 #define XERITH_AST_H
 
-#include <memory>
+#include <cstddef>
 #include <vector>
-#include <any>
 #include "../lexer/token.h"
+#include "../runtime/value.h"
+#include "../sema/symbols.h"
+#include "../utils/arena.h"
 
 namespace xerith {
 
 class BinaryExpr; class UnaryExpr; class LiteralExpr;
 class GroupingExpr; class VariableExpr; class AssignExpr;
+class CallExpr;
 
 class ExprVisitor {
 public:
     virtual ~ExprVisitor() = default;
-    virtual std::any visit_binary_expr(BinaryExpr& expr) = 0;
-    virtual std::any visit_unary_expr(UnaryExpr& expr) = 0;
-    virtual std::any visit_literal_expr(LiteralExpr& expr) = 0;
-    virtual std::any visit_grouping_expr(GroupingExpr& expr) = 0;
-    virtual std::any visit_variable_expr(VariableExpr& expr) = 0;
-    virtual std::any visit_assign_expr(AssignExpr& expr) = 0;
-};
-
+    virtual Value visit_binary_expr(BinaryExpr& expr) = 0;
+    virtual Value visit_unary_expr(UnaryExpr& expr) = 0;
+    virtual Value visit_literal_expr(LiteralExpr& expr) = 0;
+    virtual Value visit_grouping_expr(GroupingExpr& expr) = 0;
+    virtual Value visit_variable_expr(VariableExpr& expr) = 0;
+    virtual Value visit_assign_expr(AssignExpr& expr) = 0;
+    virtual Value visit_call_expr(CallExpr& expr) = 0;
+};
+
+/**
+ * @brief Arena-owned array of child nodes.
+ */
+template <typename T>
+struct NodeList {
+    T** items = nullptr;
+    size_t count = 0;
+
+    T** begin() const { return items; }
+    T** end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+/**
+ * @brief Base of all expression nodes.
+ * Nodes live in the Arena the Parser was given and are never deleted
+ * through a base pointer; children are plain pointers into that arena.
+ */
 class Expr {
 public:
-    virtual ~Expr() = default;
-    virtual std::any accept(ExprVisitor& visitor) = 0;
+    virtual Value accept(ExprVisitor& visitor) = 0;
+
+protected:
+    ~Expr() = default;
 };
 
 class BinaryExpr : public Expr {
 public:
-    std::unique_ptr<Expr> left, right;
+    Expr* left;
+    Expr* right;
     Token op;
-    BinaryExpr(std::unique_ptr<Expr> left, Token op, std::unique_ptr<Expr> right)
-        : left(std::move(left)), op(std::move(op)), right(std::move(right)) {}
-    std::any accept(ExprVisitor& visitor) override { return visitor.visit_binary_expr(*this); }
+    BinaryExpr(Expr* left, Token op, Expr* right)
+        : left(left), op(std::move(op)), right(right) {}
+    Value accept(ExprVisitor& visitor) override { return visitor.visit_binary_expr(*this); }
 };
 
 class UnaryExpr : public Expr {
 public:
     Token op;
-    std::unique_ptr<Expr> right;
-    UnaryExpr(Token op, std::unique_ptr<Expr> right) : op(std::move(op)), right(std::move(right)) {}
-    std::any accept(ExprVisitor& visitor) override { return visitor.visit_unary_expr(*this); }
+    Expr* right;
+    UnaryExpr(Token op, Expr* right) : op(std::move(op)), right(right) {}
+    Value accept(ExprVisitor& visitor) override { return visitor.visit_unary_expr(*this); }
 };
 
 class LiteralExpr : public Expr {
 public:
     Token value;
-    LiteralExpr(Token value) : value(std::move(value)) {}
-    std::any accept(ExprVisitor& visitor) override { return visitor.visit_literal_expr(*this); }
+    Value constant;  // decoded once by the Parser, or the result of folding
+    LiteralExpr(Token value, Value constant) : value(value), constant(std::move(constant)) {}
+    Value accept(ExprVisitor& visitor) override { return visitor.visit_literal_expr(*this); }
 };
 
 class GroupingExpr : public Expr {
 public:
-    std::unique_ptr<Expr> expression;
-    GroupingExpr(std::unique_ptr<Expr> expression) : expression(std::move(expression)) {}
-    std::any accept(ExprVisitor& visitor) override { return visitor.visit_grouping_expr(*this); }
+    Expr* expression;
+    GroupingExpr(Expr* expression) : expression(expression) {}
+    Value accept(ExprVisitor& visitor) override { return visitor.visit_grouping_expr(*this); }
 };
 
 class VariableExpr : public Expr {
 public:
     Token name;
+    SymbolRef target;  // filled in by the Resolver
     VariableExpr(Token name) : name(std::move(name)) {}
-    std::any accept(ExprVisitor& visitor) override { return visitor.visit_variable_expr(*this); }
+    Value accept(ExprVisitor& visitor) override { return visitor.visit_variable_expr(*this); }
 };
 
 class AssignExpr : public Expr {
 public:
     Token name;
-    std::unique_ptr<Expr> value;
-    AssignExpr(Token name, std::unique_ptr<Expr> value) : name(std::move(name)), value(std::move(value)) {}
-    std::any accept(ExprVisitor& visitor) override { return visitor.visit_assign_expr(*this); }
+    SymbolRef target;  // filled in by the Resolver
+    Expr* value;
+    AssignExpr(Token name, Expr* value) : name(std::move(name)), value(value) {}
+    Value accept(ExprVisitor& visitor) override { return visitor.visit_assign_expr(*this); }
+};
+
+using ExprList = NodeList<Expr>;
+
+class CallExpr : public Expr {
+public:
+    Expr* callee;
+    Token paren;  // the closing ')', where call errors are reported
+    ExprList arguments;
+    CallExpr(Expr* callee, Token paren, ExprList arguments)
+        : callee(callee), paren(paren), arguments(arguments) {}
+    Value accept(ExprVisitor& visitor) override { return visitor.visit_call_expr(*this); }
 };
 
 class PrintStmt; class ExpressionStmt; class VarStmt;
 class BlockStmt; class WhileStmt; class IfStmt;
+class FunctionStmt; class ReturnStmt;
 
 class StmtVisitor {
 public:
     virtual ~StmtVisitor() = default;
-    virtual std::any visit_print_stmt(PrintStmt& stmt) = 0;
-    virtual std::any visit_expression_stmt(ExpressionStmt& stmt) = 0;
-    virtual std::any visit_var_stmt(VarStmt& stmt) = 0;
-    virtual std::any visit_block_stmt(BlockStmt& stmt) = 0;
-    virtual std::any visit_while_stmt(WhileStmt& stmt) = 0;
-    virtual std::any visit_if_stmt(IfStmt& stmt) = 0;
+    virtual void visit_print_stmt(PrintStmt& stmt) = 0;
+    virtual void visit_expression_stmt(ExpressionStmt& stmt) = 0;
+    virtual void visit_var_stmt(VarStmt& stmt) = 0;
+    virtual void visit_block_stmt(BlockStmt& stmt) = 0;
+    virtual void visit_while_stmt(WhileStmt& stmt) = 0;
+    virtual void visit_if_stmt(IfStmt& stmt) = 0;
+    virtual void visit_function_stmt(FunctionStmt& stmt) = 0;
+    virtual void visit_return_stmt(ReturnStmt& stmt) = 0;
 };
 
 class Stmt {
 public:
-    virtual ~Stmt() = default;
-    virtual std::any accept(StmtVisitor& visitor) = 0;
+    Span span;  // first token of the statement, set by the Parser
+
+    virtual void accept(StmtVisitor& visitor) = 0;
+
+protected:
+    ~Stmt() = default;
 };
 
+using StmtList = NodeList<Stmt>;
+
 class PrintStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> expression;
-    PrintStmt(std::unique_ptr<Expr> expression) : expression(std::move(expression)) {}
-    std::any accept(StmtVisitor& visitor) override { return visitor.visit_print_stmt(*this); }
+    Expr* expression;
+    PrintStmt(Expr* expression) : expression(expression) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_print_stmt(*this); }
 };
 
 class ExpressionStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> expression;
-    ExpressionStmt(std::unique_ptr<Expr> expression) : expression(std::move(expression)) {}
-    std::any accept(StmtVisitor& visitor) override { return visitor.visit_expression_stmt(*this); }
+    Expr* expression;
+    ExpressionStmt(Expr* expression) : expression(expression) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_expression_stmt(*this); }
 };
 
 class VarStmt : public Stmt {
 public:
     Token name;
-    std::unique_ptr<Expr> initializer;
-    VarStmt(Token name, std::unique_ptr<Expr> initializer)
-        : name(std::move(name)), initializer(std::move(initializer)) {}
-    std::any accept(StmtVisitor& visitor) override { return visitor.visit_var_stmt(*this); }
+    int slot = -1;    // frame slot assigned by the Resolver; -1 for globals
+    int global = -1;  // GlobalTable index when `slot` is -1
+    bool boxed = false;  // a closure captures it, so the slot holds an ObjUpvalue
+    Expr* initializer;
+    VarStmt(Token name, Expr* initializer)
+        : name(std::move(name)), initializer(initializer) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_var_stmt(*this); }
 };
 
 class BlockStmt : public Stmt {
 public:
-    std::vector<std::unique_ptr<Stmt>> statements;
-    BlockStmt(std::vector<std::unique_ptr<Stmt>> statements) : statements(std::move(statements)) {}
-    std::any accept(StmtVisitor& visitor) override { return visitor.visit_block_stmt(*this); }
+    StmtList statements;
+    int slot_count = 0;  // frame size computed by the Resolver
+    BlockStmt(StmtList statements) : statements(statements) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_block_stmt(*this); }
 };
 
 class WhileStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> body;
-    WhileStmt(std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body)
-        : condition(std::move(condition)), body(std::move(body)) {}
-    std::any accept(StmtVisitor& visitor) override { return visitor.visit_while_stmt(*this); }
+    Expr* condition;
+    Stmt* body;
+    WhileStmt(Expr* condition, Stmt* body)
+        : condition(condition), body(body) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_while_stmt(*this); }
 };
 
 class IfStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> then_branch;
-    std::unique_ptr<Stmt> else_branch;
-    IfStmt(std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> then_branch, std::unique_ptr<Stmt> else_branch)
-        : condition(std::move(condition)), then_branch(std::move(then_branch)), else_branch(std::move(else_branch)) {}
-    std::any accept(StmtVisitor& visitor) override { return visitor.visit_if_stmt(*this); }
+    Expr* condition;
+    Stmt* then_branch;
+    Stmt* else_branch;
+    IfStmt(Expr* condition, Stmt* then_branch, Stmt* else_branch)
+        : condition(condition), then_branch(then_branch), else_branch(else_branch) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_if_stmt(*this); }
+};
+
+class FunctionStmt : public Stmt {
+public:
+    Token name;
+    NodeList<Token> params;
+    StmtList body;
+    int slot = -1;        // like VarStmt: frame slot, or -1 for a global
+    int global = -1;
+    bool boxed = false;
+    int slot_count = 0;   // parameters plus the body's own locals
+    std::vector<Capture> captures;  // what each closure over it captures, by upvalue index
+    std::vector<int> boxed_params;  // parameter slots boxed on entry
+    FunctionStmt(Token name, NodeList<Token> params, StmtList body)
+        : name(std::move(name)), params(params), body(body) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_function_stmt(*this); }
 };
 
-} 
+class ReturnStmt : public Stmt {
+public:
+    Token keyword;
+    Expr* value;                    // null for a bare `return;`
+    CallExpr* tail_call = nullptr;  // `value` itself, when it is a call
+    ReturnStmt(Token keyword, Expr* value) : keyword(std::move(keyword)), value(value) {}
+    void accept(StmtVisitor& visitor) override { visitor.visit_return_stmt(*this); }
+};
+
+} // namespace xerith
+
 #endif
\ No newline at end of file
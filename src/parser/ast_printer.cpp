@@ -3,24 +3,50 @@
 
 namespace xerith {
 
-std::string ASTPrinter::print(const std::vector<std::unique_ptr<Stmt>>& statements) {
+std::string ASTPrinter::print(const StmtList& statements) {
     std::stringstream ss;
-    for (const auto& stmt : statements) {
-        ss << print_stmt(stmt.get()) << "\n";
+    for (Stmt* stmt : statements) {
+        ss << print_stmt(stmt) << "\n";
     }
     return ss.str();
 }
 
 std::string ASTPrinter::print_stmt(Stmt* stmt) {
     if (auto* s = dynamic_cast<VarStmt*>(stmt)) {
-        std::string init = s->initializer ? print(s->initializer.get()) : "nil";
-        return "(let " + s->name.lexeme + " " + init + ")";
+        std::string init = s->initializer ? print(s->initializer) : "nil";
+        return "(let " + std::string(s->name.lexeme) + " " + init + ")";
     }
     if (auto* s = dynamic_cast<PrintStmt*>(stmt)) {
-        return "(print " + print(s->expression.get()) + ")";
+        return "(print " + print(s->expression) + ")";
     }
     if (auto* s = dynamic_cast<ExpressionStmt*>(stmt)) {
-        return "(stmt " + print(s->expression.get()) + ")";
+        return "(stmt " + print(s->expression) + ")";
+    }
+    if (auto* s = dynamic_cast<BlockStmt*>(stmt)) {
+        std::string result = "(block";
+        for (Stmt* inner : s->statements) result += " " + print_stmt(inner);
+        return result + ")";
+    }
+    if (auto* s = dynamic_cast<IfStmt*>(stmt)) {
+        std::string result = "(if " + print(s->condition) + " " + print_stmt(s->then_branch);
+        if (s->else_branch) result += " " + print_stmt(s->else_branch);
+        return result + ")";
+    }
+    if (auto* s = dynamic_cast<WhileStmt*>(stmt)) {
+        return "(while " + print(s->condition) + " " + print_stmt(s->body) + ")";
+    }
+    if (auto* s = dynamic_cast<FunctionStmt*>(stmt)) {
+        std::string result = "(fn " + std::string(s->name.lexeme) + " (";
+        for (size_t i = 0; i < s->params.size(); i++) {
+            if (i > 0) result += " ";
+            result += std::string(s->params.items[i]->lexeme);
+        }
+        result += ")";
+        for (Stmt* inner : s->body) result += " " + print_stmt(inner);
+        return result + ")";
+    }
+    if (auto* s = dynamic_cast<ReturnStmt*>(stmt)) {
+        return s->value ? "(return " + print(s->value) + ")" : "(return)";
     }
     return "(unknown stmt)";
 }
@@ -29,24 +55,38 @@ std::string ASTPrinter::print(Expr* expr) {
     if (!expr) return "nil";
 
     if (auto* e = dynamic_cast<BinaryExpr*>(expr)) {
-        return parenthesize(e->op.lexeme, {e->left.get(), e->right.get()});
+        return parenthesize(std::string(e->op.lexeme), {e->left, e->right});
     }
     if (auto* e = dynamic_cast<GroupingExpr*>(expr)) {
-        return parenthesize("group", {e->expression.get()});
+        return parenthesize("group", {e->expression});
     }
     if (auto* e = dynamic_cast<LiteralExpr*>(expr)) {
-        return e->value.lexeme;
+        return print_literal(e->constant);
     }
     if (auto* e = dynamic_cast<UnaryExpr*>(expr)) {
-        return parenthesize(e->op.lexeme, {e->right.get()});
+        return parenthesize(std::string(e->op.lexeme), {e->right});
     }
     if (auto* e = dynamic_cast<VariableExpr*>(expr)) {
-        return "(var " + e->name.lexeme + ")";
+        return "(var " + std::string(e->name.lexeme) + ")";
+    }
+    if (auto* e = dynamic_cast<AssignExpr*>(expr)) {
+        return "(= " + std::string(e->name.lexeme) + " " + print(e->value) + ")";
+    }
+
+    if (auto* e = dynamic_cast<CallExpr*>(expr)) {
+        std::vector<Expr*> arguments(e->arguments.begin(), e->arguments.end());
+        return parenthesize("call " + print(e->callee), arguments);
     }
 
     return "?";
 }
 
+std::string ASTPrinter::print_literal(const Value& value) {
+    // Quote strings so folded "1" and 1 stay distinguishable.
+    if (value.is_string()) return "\"" + value.as_string() + "\"";
+    return to_string(value);
+}
+
 std::string ASTPrinter::parenthesize(const std::string& name, const std::vector<Expr*>& exprs) {
     std::stringstream ss;
     ss << "(" << name;
@@ -4,210 +4,336 @@
 
 namespace xerith {
 
-Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens) {}
+Parser::Parser(Lexer& lexer, Arena& arena)
+    : lexer(lexer), current(lexer.next_token()), last(current), arena(arena) {}
 
-std::vector<std::unique_ptr<Stmt>> Parser::parse() {
-    std::vector<std::unique_ptr<Stmt>> statements;
+StmtList Parser::parse() {
+    size_t mark = scratch.size();
     while (!is_at_end()) {
-        auto decl = declaration();
-        if (decl) statements.push_back(std::move(decl));
+        Stmt* decl = declaration();
+        if (decl) scratch.push_back(decl);
     }
-    return statements;
+    return take_list(mark);
 }
 
-std::unique_ptr<Stmt> Parser::declaration() {
+template <typename T>
+NodeList<T> Parser::take_list(std::vector<T*>& pending, size_t mark) {
+    NodeList<T> list;
+    list.count = pending.size() - mark;
+    list.items = arena.alloc_array<T*>(list.count);
+    std::copy(pending.begin() + mark, pending.end(), list.items);
+    pending.resize(mark);
+    return list;
+}
+
+Stmt* Parser::declaration() {
+    // Entries a failed statement leaves in the scratch buffers sit below
+    // every later mark, so only the function depth needs restoring.
+    int depth = function_depth;
     try {
-        if (match({TokenType::LET})) return var_declaration();
+        if (match(TokenType::LET)) {
+            Span start = previous().span;
+            Stmt* stmt = var_declaration();
+            stmt->span = start;
+            return stmt;
+        }
+        if (match(TokenType::FN) || match(TokenType::FUN)) {
+            Span start = previous().span;
+            Stmt* stmt = function_declaration();
+            stmt->span = start;
+            return stmt;
+        }
         return statement();
     } catch (const std::runtime_error& error) {
-        std::cerr << "[Parse Error] " << error.what() << std::endl;
+        Diagnostics::err() << "[Parse Error] " << error.what() << std::endl;
+        error_reported = true;
+        function_depth = depth;
         synchronize();
         return nullptr;
     }
 }
 
-std::unique_ptr<Stmt> Parser::var_declaration() {
+Stmt* Parser::var_declaration() {
     Token name = consume(TokenType::IDENTIFIER, "Expect variable name.");
-    std::unique_ptr<Expr> initializer = nullptr;
-    if (match({TokenType::EQUAL})) initializer = expression();
+    Expr* initializer = nullptr;
+    if (match(TokenType::EQUAL)) initializer = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
-    return std::make_unique<VarStmt>(name, std::move(initializer));
+    return make<VarStmt>(name, initializer);
+}
+
+Stmt* Parser::function_declaration() {
+    Token name = consume(TokenType::IDENTIFIER, "Expect function name.");
+    consume(TokenType::LEFT_PAREN, "Expect '(' after function name.");
+    size_t mark = param_scratch.size();
+    if (!check(TokenType::RIGHT_PAREN)) {
+        do {
+            if (param_scratch.size() - mark == MAX_ARGUMENTS) throw std::runtime_error("Can't have more than 255 parameters.");
+            const Token& param = consume(TokenType::IDENTIFIER, "Expect parameter name.");
+            for (size_t i = mark; i < param_scratch.size(); i++) {
+                if (param_scratch[i]->lexeme == param.lexeme) {
+                    throw std::runtime_error("Duplicate parameter '" + std::string(param.lexeme) + "'.");
+                }
+            }
+            param_scratch.push_back(arena.construct<Token>(param));
+        } while (match(TokenType::COMMA));
+    }
+    NodeList<Token> params = take_list(param_scratch, mark);
+    consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters.");
+    consume(TokenType::LEFT_BRACE, "Expect '{' before function body.");
+
+    function_depth++;
+    StmtList body = block();
+    function_depth--;
+    return make<FunctionStmt>(name, params, body);
 }
 
-std::unique_ptr<Stmt> Parser::statement() {
-    if (match({TokenType::IF})) return if_statement();
-    if (match({TokenType::FOR})) return for_statement();
-    if (match({TokenType::PRINT})) return print_statement();
-    if (match({TokenType::WHILE})) return while_statement();
-    if (match({TokenType::LEFT_BRACE})) return std::make_unique<BlockStmt>(block());
-    return expression_statement();
+Stmt* Parser::statement() {
+    Span start = current.span;
+    Stmt* stmt;
+    if (match(TokenType::IF)) stmt = if_statement();
+    else if (match(TokenType::FOR)) stmt = for_statement();
+    else if (match(TokenType::PRINT)) stmt = print_statement();
+    else if (match(TokenType::RETURN)) stmt = return_statement();
+    else if (match(TokenType::WHILE)) stmt = while_statement();
+    else if (match(TokenType::LEFT_BRACE)) stmt = make<BlockStmt>(block());
+    else stmt = expression_statement();
+    stmt->span = start;
+    return stmt;
 }
 
-std::unique_ptr<Stmt> Parser::if_statement() {
+Stmt* Parser::if_statement() {
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'if'.");
     auto condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after if condition.");
 
     auto then_branch = statement();
-    std::unique_ptr<Stmt> else_branch = nullptr;
-    if (match({TokenType::ELSE})) {
+    Stmt* else_branch = nullptr;
+    if (match(TokenType::ELSE)) {
         else_branch = statement();
     }
 
-    return std::make_unique<IfStmt>(std::move(condition), std::move(then_branch), std::move(else_branch));
+    return make<IfStmt>(condition, then_branch, else_branch);
 }
 
-std::unique_ptr<Stmt> Parser::for_statement() {
+Stmt* Parser::for_statement() {
+    // The desugared nodes all report the `for` keyword as their location.
+    Span start = previous().span;
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'for'.");
-    std::unique_ptr<Stmt> initializer;
-    if (match({TokenType::SEMICOLON})) initializer = nullptr;
-    else if (match({TokenType::LET})) initializer = var_declaration();
+    Stmt* initializer;
+    if (match(TokenType::SEMICOLON)) initializer = nullptr;
+    else if (match(TokenType::LET)) initializer = var_declaration();
     else initializer = expression_statement();
+    if (initializer != nullptr) initializer->span = start;
 
-    std::unique_ptr<Expr> condition = nullptr;
+    Expr* condition = nullptr;
     if (!check(TokenType::SEMICOLON)) condition = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after loop condition.");
 
-    std::unique_ptr<Expr> increment = nullptr;
+    Expr* increment = nullptr;
     if (!check(TokenType::RIGHT_PAREN)) increment = expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after for clauses.");
 
-    std::unique_ptr<Stmt> body = statement();
+    Stmt* body = statement();
     if (increment != nullptr) {
-        std::vector<std::unique_ptr<Stmt>> body_stmts;
-        body_stmts.push_back(std::move(body));
-        body_stmts.push_back(std::make_unique<ExpressionStmt>(std::move(increment)));
-        body = std::make_unique<BlockStmt>(std::move(body_stmts));
+        size_t mark = scratch.size();
+        scratch.push_back(body);
+        scratch.push_back(make<ExpressionStmt>(increment));
+        scratch.back()->span = start;
+        body = make<BlockStmt>(take_list(mark));
+        body->span = start;
     }
-    if (condition == nullptr) condition = std::make_unique<LiteralExpr>(Token(TokenType::TRUE, "true", previous().span));
-    body = std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    if (condition == nullptr) condition = make<LiteralExpr>(Token(TokenType::TRUE, "true", previous().span), Value(true));
+    body = make<WhileStmt>(condition, body);
+    body->span = start;
     if (initializer != nullptr) {
-        std::vector<std::unique_ptr<Stmt>> wrapper;
-        wrapper.push_back(std::move(initializer));
-        wrapper.push_back(std::move(body));
-        body = std::make_unique<BlockStmt>(std::move(wrapper));
+        size_t mark = scratch.size();
+        scratch.push_back(initializer);
+        scratch.push_back(body);
+        body = make<BlockStmt>(take_list(mark));
     }
     return body;
 }
 
-std::unique_ptr<Stmt> Parser::while_statement() {
+Stmt* Parser::while_statement() {
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'while'.");
     auto condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after condition.");
     auto body = statement();
-    return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    return make<WhileStmt>(condition, body);
 }
 
-std::unique_ptr<Stmt> Parser::print_statement() {
+Stmt* Parser::print_statement() {
     auto value = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after value.");
-    return std::make_unique<PrintStmt>(std::move(value));
+    return make<PrintStmt>(value);
+}
+
+Stmt* Parser::return_statement() {
+    Token keyword = previous();
+    if (function_depth == 0) throw std::runtime_error("Can't return from top-level code.");
+    Expr* value = nullptr;
+    if (!check(TokenType::SEMICOLON)) value = expression();
+    consume(TokenType::SEMICOLON, "Expect ';' after return value.");
+    auto* stmt = make<ReturnStmt>(keyword, value);
+    stmt->tail_call = dynamic_cast<CallExpr*>(value);
+    return stmt;
 }
 
-std::unique_ptr<Stmt> Parser::expression_statement() {
+Stmt* Parser::expression_statement() {
     auto expr = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after expression.");
-    return std::make_unique<ExpressionStmt>(std::move(expr));
+    return make<ExpressionStmt>(expr);
 }
 
-std::vector<std::unique_ptr<Stmt>> Parser::block() {
-    std::vector<std::unique_ptr<Stmt>> statements;
+StmtList Parser::block() {
+    size_t mark = scratch.size();
     while (!check(TokenType::RIGHT_BRACE) && !is_at_end()) {
-        statements.push_back(declaration());
+        Stmt* decl = declaration();
+        if (decl) scratch.push_back(decl);
     }
+    if (!check(TokenType::RIGHT_BRACE)) scratch.resize(mark);
     consume(TokenType::RIGHT_BRACE, "Expect '}' after block.");
-    return statements;
+    return take_list(mark);
 }
 
-std::unique_ptr<Expr> Parser::expression() { return assignment(); }
+Expr* Parser::expression() { return parse_precedence(Precedence::ASSIGNMENT); }
 
-std::unique_ptr<Expr> Parser::assignment() {
-    auto expr = equality();
-    if (match({TokenType::EQUAL})) {
-        Token equals = previous();
-        auto value = assignment();
-        if (VariableExpr* v = dynamic_cast<VariableExpr*>(expr.get())) {
-            return std::make_unique<AssignExpr>(v->name, std::move(value));
-        }
-        throw std::runtime_error("Invalid assignment target.");
+// Indexed by TokenType. `and`/`or` have precedence levels reserved in
+// Precedence but no rules until the AST grows a logical node.
+const Parser::ParseRule Parser::rules[] = {
+    {&Parser::grouping, &Parser::call,   Precedence::CALL},        // LEFT_PAREN
+    {nullptr,           nullptr,         Precedence::NONE},        // RIGHT_PAREN
+    {nullptr,           nullptr,         Precedence::NONE},        // LEFT_BRACE
+    {nullptr,           nullptr,         Precedence::NONE},        // RIGHT_BRACE
+    {nullptr,           nullptr,         Precedence::NONE},        // COMMA
+    {nullptr,           nullptr,         Precedence::NONE},        // DOT
+    {&Parser::unary,    &Parser::binary, Precedence::TERM},        // MINUS
+    {nullptr,           &Parser::binary, Precedence::TERM},        // PLUS
+    {nullptr,           nullptr,         Precedence::NONE},        // SEMICOLON
+    {nullptr,           &Parser::binary, Precedence::FACTOR},      // SLASH
+    {nullptr,           &Parser::binary, Precedence::FACTOR},      // STAR
+    {&Parser::unary,    nullptr,         Precedence::NONE},        // BANG
+    {nullptr,           &Parser::binary, Precedence::EQUALITY},    // BANG_EQUAL
+    {nullptr,           nullptr,         Precedence::NONE},        // EQUAL
+    {nullptr,           &Parser::binary, Precedence::EQUALITY},    // EQUAL_EQUAL
+    {nullptr,           &Parser::binary, Precedence::COMPARISON},  // GREATER
+    {nullptr,           &Parser::binary, Precedence::COMPARISON},  // GREATER_EQUAL
+    {nullptr,           &Parser::binary, Precedence::COMPARISON},  // LESS
+    {nullptr,           &Parser::binary, Precedence::COMPARISON},  // LESS_EQUAL
+    {&Parser::variable, nullptr,         Precedence::NONE},        // IDENTIFIER
+    {&Parser::literal,  nullptr,         Precedence::NONE},        // STRING
+    {&Parser::literal,  nullptr,         Precedence::NONE},        // NUMBER
+    {nullptr,           nullptr,         Precedence::NONE},        // AND
+    {nullptr,           nullptr,         Precedence::NONE},        // CLASS
+    {nullptr,           nullptr,         Precedence::NONE},        // ELSE
+    {&Parser::literal,  nullptr,         Precedence::NONE},        // FALSE
+    {nullptr,           nullptr,         Precedence::NONE},        // FUN
+    {nullptr,           nullptr,         Precedence::NONE},        // FOR
+    {nullptr,           nullptr,         Precedence::NONE},        // IF
+    {&Parser::literal,  nullptr,         Precedence::NONE},        // NIL
+    {nullptr,           nullptr,         Precedence::NONE},        // OR
+    {nullptr,           nullptr,         Precedence::NONE},        // PRINT
+    {nullptr,           nullptr,         Precedence::NONE},        // RETURN
+    {nullptr,           nullptr,         Precedence::NONE},        // SUPER
+    {nullptr,           nullptr,         Precedence::NONE},        // THIS
+    {&Parser::literal,  nullptr,         Precedence::NONE},        // TRUE
+    {nullptr,           nullptr,         Precedence::NONE},        // LET
+    {nullptr,           nullptr,         Precedence::NONE},        // WHILE
+    {nullptr,           nullptr,         Precedence::NONE},        // FN
+    {nullptr,           nullptr,         Precedence::NONE},        // END_OF_FILE
+};
+
+Expr* Parser::parse_precedence(Precedence precedence) {
+    static_assert(sizeof(rules) / sizeof(rules[0]) == static_cast<size_t>(TokenType::END_OF_FILE) + 1,
+                  "Parser::rules needs one entry per TokenType");
+    PrefixFn prefix = rule(peek().type).prefix;
+    if (prefix == nullptr) throw std::runtime_error("Expect expression.");
+    advance();
+    bool can_assign = precedence <= Precedence::ASSIGNMENT;
+    Expr* expr = (this->*prefix)(can_assign);
+
+    while (precedence <= rule(peek().type).precedence) {
+        InfixFn infix = rule(advance().type).infix;
+        expr = (this->*infix)(expr);
     }
+    // Anything still holding an '=' here was not a variable.
+    if (can_assign && match(TokenType::EQUAL)) throw std::runtime_error("Invalid assignment target.");
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::equality() {
-    auto expr = comparison();
-    while (match({TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL})) {
-        Token op = previous();
-        auto right = comparison();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
-    }
-    return expr;
+Expr* Parser::grouping(bool) {
+    auto expr = expression();
+    consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
+    return make<GroupingExpr>(expr);
 }
 
-std::unique_ptr<Expr> Parser::comparison() {
-    auto expr = term();
-    while (match({TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL})) {
-        Token op = previous();
-        auto right = term();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
-    }
-    return expr;
+Expr* Parser::unary(bool) {
+    Token op = previous();
+    auto right = parse_precedence(Precedence::UNARY);
+    return make<UnaryExpr>(op, right);
 }
 
-std::unique_ptr<Expr> Parser::term() {
-    auto expr = factor();
-    while (match({TokenType::MINUS, TokenType::PLUS})) {
-        Token op = previous();
-        auto right = factor();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
+Expr* Parser::literal(bool) {
+    // Literals are decoded here, once, rather than on every evaluation.
+    const Token& token = previous();
+    switch (token.type) {
+        case TokenType::FALSE: return make<LiteralExpr>(token, Value(false));
+        case TokenType::TRUE: return make<LiteralExpr>(token, Value(true));
+        case TokenType::NUMBER: return make<LiteralExpr>(token, Value(parse_number(token.lexeme)));
+        case TokenType::STRING: return make<LiteralExpr>(token, Value(token.interned));
+        default: return make<LiteralExpr>(token, Value());
     }
-    return expr;
 }
 
-std::unique_ptr<Expr> Parser::factor() {
-    auto expr = unary();
-    while (match({TokenType::SLASH, TokenType::STAR})) {
-        Token op = previous();
-        auto right = unary();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
+Expr* Parser::variable(bool can_assign) {
+    Token name = previous();
+    if (can_assign && match(TokenType::EQUAL)) {
+        // Right-associative: the value may itself be an assignment.
+        auto value = parse_precedence(Precedence::ASSIGNMENT);
+        return make<AssignExpr>(name, value);
     }
-    return expr;
+    return make<VariableExpr>(name);
 }
 
-std::unique_ptr<Expr> Parser::unary() {
-    if (match({TokenType::BANG, TokenType::MINUS})) {
-        Token op = previous();
-        auto right = unary();
-        return std::make_unique<UnaryExpr>(op, std::move(right));
-    }
-    return primary();
-}
-
-std::unique_ptr<Expr> Parser::primary() {
-    if (match({TokenType::FALSE})) return std::make_unique<LiteralExpr>(previous());
-    if (match({TokenType::TRUE})) return std::make_unique<LiteralExpr>(previous());
-    if (match({TokenType::NIL})) return std::make_unique<LiteralExpr>(previous());
-    if (match({TokenType::NUMBER, TokenType::STRING})) return std::make_unique<LiteralExpr>(previous());
-    if (match({TokenType::IDENTIFIER})) return std::make_unique<VariableExpr>(previous());
-    if (match({TokenType::LEFT_PAREN})) {
-        auto expr = expression();
-        consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
-        return std::make_unique<GroupingExpr>(std::move(expr));
+Expr* Parser::binary(Expr* left) {
+    Token op = previous();
+    // Left-associative: the right operand binds one level tighter.
+    Precedence next = static_cast<Precedence>(static_cast<int>(rule(op.type).precedence) + 1);
+    auto right = parse_precedence(next);
+    return make<BinaryExpr>(left, op, right);
+}
+
+Expr* Parser::call(Expr* callee) {
+    size_t mark = argument_scratch.size();
+    if (!check(TokenType::RIGHT_PAREN)) {
+        do {
+            if (argument_scratch.size() - mark == MAX_ARGUMENTS) throw std::runtime_error("Can't have more than 255 arguments.");
+            // Nested calls push above `mark` and take their own tail first.
+            Expr* argument = expression();
+            argument_scratch.push_back(argument);
+        } while (match(TokenType::COMMA));
     }
-    throw std::runtime_error("Expect expression.");
+    ExprList arguments = take_list(argument_scratch, mark);
+    const Token& paren = consume(TokenType::RIGHT_PAREN, "Expect ')' after arguments.");
+    return make<CallExpr>(callee, paren, arguments);
 }
 
-bool Parser::match(const std::vector<TokenType>& types) {
-    for (auto type : types) { if (check(type)) { advance(); return true; } }
-    return false;
+bool Parser::match(TokenType type) {
+    if (!check(type)) return false;
+    advance();
+    return true;
 }
 
 bool Parser::check(TokenType type) const { return !is_at_end() && peek().type == type; }
-Token Parser::advance() { if (!is_at_end()) current++; return previous(); }
+const Token& Parser::advance() {
+    if (!is_at_end()) {
+        last = current;
+        current = lexer.next_token();
+    }
+    return previous();
+}
 bool Parser::is_at_end() const { return peek().type == TokenType::END_OF_FILE; }
-Token Parser::peek() const { return tokens[current]; }
-Token Parser::previous() const { return tokens[current - 1]; }
-Token Parser::consume(TokenType type, const std::string& message) {
+const Token& Parser::consume(TokenType type, const char* message) {
     if (check(type)) return advance();
     throw std::runtime_error(message);
 }
@@ -217,7 +343,7 @@ void Parser::synchronize() {
     while (!is_at_end()) {
         if (previous().type == TokenType::SEMICOLON) return;
         switch (peek().type) {
-            case TokenType::CLASS: case TokenType::FUN: case TokenType::LET:
+            case TokenType::CLASS: case TokenType::FUN: case TokenType::FN: case TokenType::LET:
             case TokenType::FOR: case TokenType::IF: case TokenType::WHILE:
             case TokenType::PRINT: case TokenType::RETURN: return;
             default: break;
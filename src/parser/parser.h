@@ -2,49 +2,98 @@
 #define XERITH_PARSER_H
 
 #include <vector>
-#include <memory>
-#include <string>
-#include "../lexer/token.h"
+#include "../lexer/lexer.h"
 #include "ast.h"
+#include "precedence.h"
+#include "../utils/arena.h"
+#include "../utils/stats.h"
 
 namespace xerith {
 
 class Parser {
 public:
-    explicit Parser(const std::vector<Token>& tokens);
-    std::vector<std::unique_ptr<Stmt>> parse();
+    // Pulls tokens from `lexer` on demand; there is never more than one
+    // token of lookahead. Every node is allocated in `arena`, which must
+    // outlive the tree.
+    Parser(Lexer& lexer, Arena& arena);
+    StmtList parse();
+
+    // Most parameters a function can declare, and arguments a call can pass.
+    static constexpr size_t MAX_ARGUMENTS = 255;
+
+    // True once any syntax error has been reported.
+    bool had_error() const { return error_reported; }
 
 private:
-    std::unique_ptr<Stmt> declaration();
-    std::unique_ptr<Stmt> var_declaration();
-    std::unique_ptr<Stmt> statement();
-    std::unique_ptr<Stmt> if_statement();
-    std::unique_ptr<Stmt> for_statement();
-    std::unique_ptr<Stmt> while_statement();
-    std::unique_ptr<Stmt> print_statement();
-    std::unique_ptr<Stmt> expression_statement();
-    std::vector<std::unique_ptr<Stmt>> block();
-
-    std::unique_ptr<Expr> expression();
-    std::unique_ptr<Expr> assignment();
-    std::unique_ptr<Expr> equality();
-    std::unique_ptr<Expr> comparison();
-    std::unique_ptr<Expr> term();
-    std::unique_ptr<Expr> factor();
-    std::unique_ptr<Expr> unary();
-    std::unique_ptr<Expr> primary();
-
-    bool match(const std::vector<TokenType>& types);
+    Stmt* declaration();
+    Stmt* var_declaration();
+    Stmt* function_declaration();
+    Stmt* statement();
+    Stmt* if_statement();
+    Stmt* for_statement();
+    Stmt* while_statement();
+    Stmt* print_statement();
+    Stmt* return_statement();
+    Stmt* expression_statement();
+    StmtList block();
+
+    Expr* expression();
+    // Pratt loop: parses a prefix expression, then folds in infix
+    // operators for as long as they bind at least as tightly as `precedence`.
+    Expr* parse_precedence(Precedence precedence);
+
+    // Prefix handlers run with the introducing token in previous();
+    // `can_assign` is false when an operator already claimed the operand.
+    Expr* grouping(bool can_assign);
+    Expr* unary(bool can_assign);
+    Expr* literal(bool can_assign);
+    Expr* variable(bool can_assign);
+    // Infix handlers run with the operator in previous().
+    Expr* binary(Expr* left);
+    Expr* call(Expr* left);
+
+    using PrefixFn = Expr* (Parser::*)(bool can_assign);
+    using InfixFn = Expr* (Parser::*)(Expr* left);
+    struct ParseRule {
+        PrefixFn prefix;
+        InfixFn infix;
+        Precedence precedence;
+    };
+    // One entry per TokenType, in declaration order.
+    static const ParseRule rules[];
+    static const ParseRule& rule(TokenType type) { return rules[static_cast<int>(type)]; }
+
+    bool match(TokenType type);
     bool check(TokenType type) const;
-    Token advance();
+    const Token& advance();
     bool is_at_end() const;
-    Token peek() const;
-    Token previous() const;
-    Token consume(TokenType type, const std::string& message);
+    const Token& peek() const { return current; }
+    const Token& previous() const { return last; }
+    const Token& consume(TokenType type, const char* message);
     void synchronize();
 
-    const std::vector<Token>& tokens;
-    int current = 0;
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        XERITH_STATS_COUNT(AST_NODES, 1);
+        return arena.construct<T>(std::forward<Args>(args)...);
+    }
+    // Moves `pending` entries from `mark` onwards into an arena-owned list.
+    template <typename T>
+    NodeList<T> take_list(std::vector<T*>& pending, size_t mark);
+    StmtList take_list(size_t mark) { return take_list(scratch, mark); }
+
+    Lexer& lexer;
+    Token current;
+    Token last;
+    Arena& arena;
+    // Shared buffer for statement lists under construction; nested blocks
+    // push onto the end and take their own tail.
+    std::vector<Stmt*> scratch;
+    // The same for call arguments and parameter lists.
+    std::vector<Expr*> argument_scratch;
+    std::vector<Token*> param_scratch;
+    int function_depth = 0;  // `return` is only allowed above zero
+    bool error_reported = false;
 };
 
 } // namespace xerith
@@ -0,0 +1,50 @@
+#include "repl_session.h"
+
+namespace xerith {
+
+namespace {
+
+// True if `text` leaves a bracket or a string open. Mirrors just enough
+// of the lexer to skip brackets inside strings and `//` comments; a
+// stray closer counts as complete so the parser gets to report it.
+bool is_open(const std::string& text) {
+    int depth = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        switch (text[i]) {
+            case '(': case '{': depth++; break;
+            case ')': case '}': depth--; break;
+            case '"': {
+                size_t close = text.find('"', i + 1);
+                if (close == std::string::npos) return true;
+                i = close;
+                break;
+            }
+            case '/':
+                if (i + 1 < text.size() && text[i + 1] == '/') {
+                    i = text.find('\n', i);
+                    if (i == std::string::npos) return depth > 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return depth > 0;
+}
+
+} // namespace
+
+bool ReplSession::add_line(const std::string& line) {
+    if (!pending.empty()) pending += '\n';
+    pending += line;
+    return !is_open(pending);
+}
+
+FileId ReplSession::take_input() {
+    // Tokens and the AST view this text, so the SourceManager keeps it for good.
+    FileId file = SourceManager::add("repl", std::move(pending));
+    pending.clear();
+    return file;
+}
+
+} // namespace xerith
@@ -0,0 +1,41 @@
+#ifndef XERITH_REPL_SESSION_H
+#define XERITH_REPL_SESSION_H
+
+#include <string>
+#include "../sema/symbols.h"
+#include "../utils/arena.h"
+#include "../utils/source_manager.h"
+
+namespace xerith {
+
+/**
+ * @brief Front-end state the REPL keeps from one input to the next.
+ * Every input is parsed into the same arena, so trees from earlier
+ * inputs stay valid, and resolved against the same GlobalTable, so a
+ * global keeps the slot it was first given for the whole session.
+ * Lines are buffered until parentheses and braces balance and no string
+ * is left open; a multi-line block is then lexed and parsed once.
+ */
+class ReplSession {
+public:
+    // Appends `line` to the pending input. Returns true once the input
+    // is complete and ready for take_input().
+    bool add_line(const std::string& line);
+
+    bool has_pending() const { return !pending.empty(); }
+
+    // Registers the pending input as a source file and clears it.
+    FileId take_input();
+
+    Arena& arena() { return nodes; }
+    GlobalTable& globals() { return global_slots; }
+
+private:
+    std::string pending;
+    Arena nodes;
+    GlobalTable global_slots;
+};
+
+} // namespace xerith
+
+#endif // XERITH_REPL_SESSION_H
@@ -2,52 +2,108 @@
 #define XERITH_ENVIRONMENT_H
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <any>
-#include <memory>
+#include <vector>
 #include <stdexcept>
 #include "../lexer/token.h"
+#include "heap.h"
+#include "value.h"
 
 namespace xerith {
 
-class Environment : public std::enable_shared_from_this<Environment> {
+/**
+ * @brief Storage for top-level variables, indexed by GlobalTable slot.
+ * The Resolver numbers a global as soon as it is mentioned, so a slot
+ * can exist before its `let` has run; reading or assigning it then is
+ * still an undefined-variable error. The table only grows, which keeps
+ * slots valid across REPL inputs.
+ */
+class Globals {
 public:
-    std::shared_ptr<Environment> enclosing;
-    std::unordered_map<std::string, std::any> values;
+    void define(int slot, Value value) {
+        if (slot >= static_cast<int>(values.size())) values.resize(slot + 1);
+        values[slot].value = std::move(value);
+        values[slot].defined = true;
+    }
 
-    // Constructors
-    Environment() : enclosing(nullptr) {}
-    Environment(std::shared_ptr<Environment> enclosing) : enclosing(enclosing) {}
+    const Value& get(int slot, const Token& name) const {
+        if (const Value* value = find(slot)) return *value;
+        throw undefined(name);
+    }
 
-    void define(const std::string& name, std::any value) {
-        values[name] = std::move(value);
+    // nullptr if the global has not been defined yet.
+    Value* find(int slot) {
+        return const_cast<Value*>(static_cast<const Globals*>(this)->find(slot));
     }
 
-    std::any get(const Token& name) {
-        if (values.find(name.lexeme) != values.end()) {
-            return values[name.lexeme];
-        }
+    const Value* find(int slot) const {
+        if (slot < 0 || slot >= static_cast<int>(values.size()) || !values[slot].defined) return nullptr;
+        return &values[slot].value;
+    }
 
-        if (enclosing != nullptr) return enclosing->get(name);
+    void assign(int slot, const Token& name, Value value) {
+        Value* target = find(slot);
+        if (target == nullptr) throw undefined(name);
+        *target = std::move(value);
+    }
 
-        throw std::runtime_error("Undefined variable '" + name.lexeme + "'.");
+    void trace(Tracer& tracer) const {
+        for (const Entry& entry : values) tracer.mark(entry.value);
     }
 
-    void assign(const Token& name, std::any value) {
-        if (values.find(name.lexeme) != values.end()) {
-            values[name.lexeme] = std::move(value);
-            return;
-        }
+private:
+    static std::runtime_error undefined(const Token& name) {
+        return std::runtime_error("Undefined variable '" + std::string(name.lexeme) + "'.");
+    }
 
-        if (enclosing != nullptr) {
-            enclosing->assign(name, std::move(value));
-            return;
-        }
+    struct Entry {
+        Value value;
+        bool defined = false;
+    };
+
+    std::vector<Entry> values;
+};
+
+/**
+ * @brief Contiguous storage for every live block-scoped variable.
+ * Entering a block reserves its slots on top of the stack and leaving it
+ * drops them again, so once the stack has grown to the program's deepest
+ * nesting no scope change allocates. Slot numbers come from the Resolver
+ * and are relative to `base`, which a call moves to its first argument.
+ */
+class ValueStack {
+public:
+    ValueStack() { values.reserve(256); }
 
-        throw std::runtime_error("Undefined variable '" + name.lexeme + "'.");
+    // Reserves `count` nil slots and returns the mark to rewind to.
+    size_t enter(size_t count) {
+        size_t mark = values.size();
+        if (count > 0) values.resize(mark + count);
+        return mark;
     }
+
+    void leave(size_t mark) {
+        if (values.size() != mark) values.resize(mark);
+    }
+
+    void push(Value value) { values.push_back(std::move(value)); }
+    size_t size() const { return values.size(); }
+
+    Value& at(int slot) { return values[base + slot]; }
+    // Absolute index, ignoring `base`.
+    Value& operator[](size_t index) { return values[index]; }
+
+    void trace(Tracer& tracer) const {
+        for (const Value& value : values) tracer.mark(value);
+    }
+
+    size_t base = 0;
+
+private:
+    std::vector<Value> values;
 };
 
 } // namespace xerith
 
-#endif
\ No newline at end of file
+#endif
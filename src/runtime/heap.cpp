@@ -0,0 +1,84 @@
+#include "heap.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "../utils/stats.h"
+
+namespace xerith {
+
+void ObjUpvalue::trace(Tracer& tracer) const { tracer.mark(value); }
+
+RootSource::RootSource() {
+    next = Heap::roots;
+    if (next != nullptr) next->prev = this;
+    Heap::roots = this;
+}
+
+RootSource::~RootSource() {
+    if (prev != nullptr) prev->next = next;
+    else Heap::roots = next;
+    if (next != nullptr) next->prev = prev;
+}
+
+void* Heap::allocate(size_t size) {
+    XERITH_STATS_COUNT(HEAP_BYTES, size);
+    return pool.allocate(size);
+}
+
+void Heap::collect() {
+    XERITH_STATS_PHASE(GC);
+    XERITH_STATS_COUNT(GC_RUNS, 1);
+    Tracer tracer;
+    for (RootSource* source = roots; source != nullptr; source = source->next) source->trace_roots(tracer);
+    while (!tracer.gray.empty()) {
+        const Obj* object = tracer.gray.back();
+        tracer.gray.pop_back();
+        object->trace(tracer);
+    }
+    sweep();
+
+    size_t allocated = bytes_allocated();
+    next_collection = threshold == 0 ? 0 : std::max(threshold, allocated * GROWTH_FACTOR);
+    if (limit != 0) {
+        if (allocated > limit) {
+            throw std::runtime_error("Out of memory: live objects take " + std::to_string(allocated) +
+                                     " bytes, over the " + std::to_string(limit) + "-byte heap limit.");
+        }
+        next_collection = std::min(next_collection, limit);
+    }
+}
+
+void Heap::sweep() {
+    // Objects only own strings and memory, never counts on other objects,
+    // so the order they are freed in does not matter.
+    uint64_t freed = 0;
+    Obj** link = &objects;
+    while (Obj* object = *link) {
+        if (object->marked) {
+            object->marked = false;
+            account(object);
+            link = &object->next;
+            continue;
+        }
+        *link = object->next;
+        owned -= object->owned;
+        size_t size = object->cell;
+        object->~Obj();
+        pool.deallocate(object, size);
+        freed++;
+    }
+    XERITH_STATS_COUNT(GC_FREED, freed);
+}
+
+void Heap::set_threshold(size_t bytes) {
+    threshold = bytes;
+    next_collection = bytes == 0 ? 0 : std::max(bytes, bytes_allocated() * GROWTH_FACTOR);
+    if (limit != 0) next_collection = std::min(next_collection, limit);
+}
+
+void Heap::set_limit(size_t bytes) {
+    limit = bytes;
+    if (limit != 0) next_collection = std::min(next_collection, limit);
+}
+
+} // namespace xerith
@@ -0,0 +1,136 @@
+#ifndef XERITH_HEAP_H
+#define XERITH_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "value.h"
+#include "../utils/arena.h"
+#include "../utils/stats.h"
+
+namespace xerith {
+
+/**
+ * @brief The mark phase's worklist.
+ * Marking is iterative, so a long chain of closures cannot overflow the
+ * C++ stack. Objects outside the heap, like the builtins, can be marked
+ * too; they are never swept, so their mark simply stays set.
+ */
+class Tracer {
+public:
+    void mark(const Value& value) {
+        if (value.is_obj()) mark(value.as_obj());
+    }
+
+    void mark(const Obj* object) {
+        if (object == nullptr || object->marked) return;
+        object->marked = true;
+        gray.push_back(object);
+    }
+
+private:
+    friend class Heap;
+    std::vector<const Obj*> gray;
+};
+
+/**
+ * @brief Something outside the heap that holds objects: an engine's
+ * stacks, globals and registers. It is a root for as long as it lives.
+ */
+class RootSource {
+public:
+    RootSource();
+    virtual ~RootSource();
+
+    RootSource(const RootSource&) = delete;
+    RootSource& operator=(const RootSource&) = delete;
+
+    virtual void trace_roots(Tracer& tracer) const = 0;
+
+private:
+    friend class Heap;
+    RootSource* prev = nullptr;
+    RootSource* next = nullptr;
+};
+
+/**
+ * @brief Precise mark-sweep collector for every Obj.
+ * Objects come from a Pool, so a swept object's block is reused by the
+ * next one of its size class. Strings are not in this heap: they cannot
+ * form cycles, so they keep their reference counts.
+ *
+ * Allocation never collects. The engines call safepoint() right after
+ * an allocating operation has stored its result, where every live
+ * object is reachable from a RootSource; the collector runs there once
+ * `threshold` bytes, or twice what survived the last collection, have
+ * been allocated. The heap is not thread-safe: only the thread running
+ * the engines and the compiler allocates from it.
+ */
+class Heap {
+public:
+    static constexpr size_t DEFAULT_THRESHOLD = size_t(1) << 20;
+    static constexpr size_t GROWTH_FACTOR = 2;
+
+    template <typename T, typename... Args>
+    static T* make(Args&&... args) {
+        static_assert(std::is_base_of<Obj, T>::value, "the heap only holds Obj subclasses");
+        static_assert(sizeof(T) <= UINT16_MAX, "Obj::cell is 16 bits");
+        size_t size = Pool::block_size(sizeof(T));
+        T* object = new (allocate(size)) T(std::forward<Args>(args)...);
+        object->cell = static_cast<uint16_t>(size);
+        object->next = objects;
+        objects = object;
+        account(object);
+        return object;
+    }
+
+    // Recounts what `object` owns. Called once whoever made it has filled
+    // it in; every collection recounts the survivors as well.
+    static void account(Obj* object) {
+        size_t now = object->owned_bytes();
+        if (now > object->owned) XERITH_STATS_COUNT(HEAP_BYTES, now - object->owned);
+        owned = owned - object->owned + now;
+        object->owned = static_cast<uint32_t>(now);
+    }
+
+    static void safepoint() {
+        if (bytes_allocated() >= next_collection) collect();
+    }
+
+    // Marks from every RootSource and frees what was not reached. Throws
+    // an out-of-memory runtime error if the survivors exceed the limit.
+    static void collect();
+
+    // Bytes to allocate before the first collection, and the least
+    // between two. Zero collects at every safepoint, to shake out bugs.
+    static void set_threshold(size_t bytes);
+    // The most the survivors of a collection may take; zero is no limit.
+    static void set_limit(size_t bytes);
+
+    // Bytes held by live and not yet collected objects, counting what
+    // they own as of their last account().
+    static size_t bytes_allocated() { return pool.stats().live_bytes + owned; }
+
+private:
+    friend class RootSource;
+
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    static void* allocate(size_t size);
+    static void sweep();
+
+    inline static Pool pool{CHUNK_SIZE};
+    inline static Obj* objects = nullptr;  // every allocated object, newest first
+    inline static size_t owned = 0;        // the sum of every object's `owned`
+    inline static size_t threshold = DEFAULT_THRESHOLD;
+    inline static size_t limit = 0;
+    inline static size_t next_collection = DEFAULT_THRESHOLD;
+    inline static RootSource* roots = nullptr;
+};
+
+} // namespace xerith
+
+#endif // XERITH_HEAP_H
@@ -1,136 +1,305 @@
 #include "interpreter.h"
 #include <iostream>
+#include "natives.h"
+#include "../utils/stats.h"
 
 namespace xerith {
 
-Interpreter::Interpreter() : environment(std::make_shared<Environment>()) {}
+InterpretedFunction::InterpretedFunction(FunctionStmt* declaration)
+    : ObjFunction(FunctionKind::INTERPRETED, declaration->name.interned, static_cast<int>(declaration->params.size())),
+      declaration(declaration) {}
 
-void Interpreter::interpret(const std::vector<std::unique_ptr<Stmt>>& statements) {
+void InterpretedFunction::trace(Tracer& tracer) const {
+    for (const Value& upvalue : upvalues) tracer.mark(upvalue);
+}
+
+Interpreter::Interpreter() {
+    // GlobalTable numbers the builtins first, in the same order.
+    for (size_t i = 0; i < native_count(); i++) globals.define(static_cast<int>(i), Value(native(i)));
+}
+
+Interpreter::~Interpreter() = default;
+
+void Interpreter::trace_roots(Tracer& tracer) const {
+    globals.trace(tracer);
+    locals.trace(tracer);
+    tracer.mark(return_value);
+    tracer.mark(tail_callee);
+    for (const Value& argument : tail_arguments) tracer.mark(argument);
+}
+
+void Interpreter::enable_jit() {
+    jit = std::make_unique<LoopJit>();
+    if (!jit->available()) jit.reset();
+}
+
+bool Interpreter::interpret(const StmtList& statements) {
+    if (jit) jit->forget_loops();
     try {
-        for (const auto& statement : statements) {
+        for (Stmt* statement : statements) {
             execute(*statement);
         }
     } catch (const std::runtime_error& error) {
         std::cerr << "Runtime Error: " << error.what() << std::endl;
+        locals.leave(0);
+        locals.base = 0;
+        for (; call_depth > 0; call_depth--) {
+            if (profiler != nullptr) profiler->leave();
+        }
+        returning = false;
+        return_value = Value();
+        tail_callee = Value();
+        tail_arguments.clear();
+        upvalues = nullptr;
+        return false;
     }
+    return true;
 }
 
-void Interpreter::execute(Stmt& stmt) { stmt.accept(*this); }
-std::any Interpreter::evaluate(Expr& expr) { return expr.accept(*this); }
+void Interpreter::execute(Stmt& stmt) {
+    if (profiler != nullptr) profiler->at(stmt.span);
+    stmt.accept(*this);
+}
+Value Interpreter::evaluate(Expr& expr) { return expr.accept(*this); }
 
-bool Interpreter::is_truthy(const std::any& value) {
-    if (!value.has_value()) return false;
-    if (value.type() == typeid(bool)) return std::any_cast<bool>(value);
-    return true;
+void Interpreter::check_number_operand(const Value& operand) {
+    if (!operand.is_number()) throw std::runtime_error("Operand must be a number.");
 }
 
-bool Interpreter::is_equal(const std::any& a, const std::any& b) {
-    if (a.type() != b.type()) return false;
-    if (a.type() == typeid(double)) return std::any_cast<double>(a) == std::any_cast<double>(b);
-    if (a.type() == typeid(bool)) return std::any_cast<bool>(a) == std::any_cast<bool>(b);
-    if (a.type() == typeid(std::string)) return std::any_cast<std::string>(a) == std::any_cast<std::string>(b);
-    return false;
+void Interpreter::check_number_operands(const Value& left, const Value& right) {
+    if (!left.is_number() || !right.is_number()) throw std::runtime_error("Operands must be numbers.");
 }
 
-void Interpreter::execute_block(const std::vector<std::unique_ptr<Stmt>>& statements, std::shared_ptr<Environment> inner_env) {
-    std::shared_ptr<Environment> previous = this->environment;
-    try {
-        this->environment = inner_env;
-        for (const auto& statement : statements) execute(*statement);
-    } catch (...) {
-        this->environment = previous;
-        throw;
+void Interpreter::execute_block(const StmtList& statements, size_t slot_count) {
+    XERITH_STATS_COUNT(ENVIRONMENTS, 1);
+    size_t mark = locals.enter(slot_count);
+    for (Stmt* statement : statements) {
+        execute(*statement);
+        if (returning) break;
     }
-    this->environment = previous;
+    // On a runtime error `interpret` unwinds the whole stack instead.
+    locals.leave(mark);
 }
 
-std::any Interpreter::visit_if_stmt(IfStmt& stmt) {
+void Interpreter::visit_if_stmt(IfStmt& stmt) {
     if (is_truthy(evaluate(*stmt.condition))) {
         execute(*stmt.then_branch);
     } else if (stmt.else_branch != nullptr) {
         execute(*stmt.else_branch);
     }
-    return {};
 }
 
-std::any Interpreter::visit_while_stmt(WhileStmt& stmt) {
+void Interpreter::visit_while_stmt(WhileStmt& stmt) {
+    uint32_t iterations = 0;
     while (is_truthy(evaluate(*stmt.condition))) {
         execute(*stmt.body);
+        if (returning) return;
+        // Once hot, hand the rest of the loop to native code; it resumes
+        // at the next condition check with the variables as they are now.
+        if (jit && ++iterations == LoopJit::HOT_ITERATIONS && jit->run(stmt, globals, locals)) return;
     }
-    return {};
 }
 
-std::any Interpreter::visit_block_stmt(BlockStmt& stmt) {
-    execute_block(stmt.statements, std::make_shared<Environment>(environment));
-    return {};
+void Interpreter::visit_block_stmt(BlockStmt& stmt) {
+    execute_block(stmt.statements, stmt.slot_count);
 }
 
-std::any Interpreter::visit_var_stmt(VarStmt& stmt) {
-    std::any value;
+void Interpreter::visit_var_stmt(VarStmt& stmt) {
+    Value value;
     if (stmt.initializer != nullptr) value = evaluate(*stmt.initializer);
-    environment->define(stmt.name.lexeme, value);
-    return {};
+    if (stmt.slot < 0) globals.define(stmt.global, std::move(value));
+    else if (stmt.boxed) {
+        locals.at(stmt.slot) = Value(Heap::make<ObjUpvalue>(std::move(value)));
+        Heap::safepoint();
+    } else {
+        locals.at(stmt.slot) = std::move(value);
+    }
+}
+
+void Interpreter::visit_function_stmt(FunctionStmt& stmt) {
+    auto* function = Heap::make<InterpretedFunction>(&stmt);
+    Value value(function);
+    // A closure may capture its own name, so the box comes first.
+    if (stmt.boxed) locals.at(stmt.slot) = Value(Heap::make<ObjUpvalue>(Value()));
+    function->upvalues.reserve(stmt.captures.size());
+    for (const Capture& capture : stmt.captures) {
+        function->upvalues.push_back(capture.local ? locals.at(capture.index) : upvalues[capture.index]);
+    }
+    Heap::account(function);
+    if (stmt.slot < 0) globals.define(stmt.global, std::move(value));
+    else local(stmt.slot, stmt.boxed) = std::move(value);
+    Heap::safepoint();
 }
 
-std::any Interpreter::visit_print_stmt(PrintStmt& stmt) {
-    std::any value = evaluate(*stmt.expression);
-    if (value.type() == typeid(double)) std::cout << std::any_cast<double>(value) << std::endl;
-    else if (value.type() == typeid(std::string)) std::cout << std::any_cast<std::string>(value) << std::endl;
-    else if (value.type() == typeid(bool)) std::cout << (std::any_cast<bool>(value) ? "true" : "false") << std::endl;
-    else std::cout << "nil" << std::endl;
-    return {};
+void Interpreter::visit_return_stmt(ReturnStmt& stmt) {
+    if (stmt.tail_call != nullptr) {
+        Value callee = evaluate(*stmt.tail_call->callee);
+        size_t arguments = push_arguments(callee, *stmt.tail_call);
+        if (callee.as_function()->kind == FunctionKind::INTERPRETED) {
+            // The blocks being unwound truncate `locals`, so the callee and
+            // arguments wait beside it until call() takes them.
+            for (size_t i = arguments; i < locals.size(); i++) tail_arguments.push_back(std::move(locals[i]));
+            tail_callee = std::move(locals[arguments - 1]);
+            locals.leave(arguments - 1);
+        } else {
+            return_value = call(callee.as_function(), arguments);
+        }
+    } else {
+        return_value = stmt.value != nullptr ? evaluate(*stmt.value) : Value();
+    }
+    returning = true;
 }
 
-std::any Interpreter::visit_expression_stmt(ExpressionStmt& stmt) {
+void Interpreter::visit_print_stmt(PrintStmt& stmt) {
+    Value value = evaluate(*stmt.expression);
+    std::cout << to_string(value) << std::endl;
+}
+
+void Interpreter::visit_expression_stmt(ExpressionStmt& stmt) {
     evaluate(*stmt.expression);
-    return {};
 }
 
-std::any Interpreter::visit_variable_expr(VariableExpr& expr) { return environment->get(expr.name); }
+Value Interpreter::visit_variable_expr(VariableExpr& expr) {
+    if (expr.target.is_global()) return globals.get(expr.target.global, expr.name);
+    return variable(expr.target);
+}
 
-std::any Interpreter::visit_assign_expr(AssignExpr& expr) {
-    std::any value = evaluate(*expr.value);
-    environment->assign(expr.name, value);
+Value Interpreter::visit_assign_expr(AssignExpr& expr) {
+    Value value = evaluate(*expr.value);
+    if (expr.target.is_global()) globals.assign(expr.target.global, expr.name, value);
+    else variable(expr.target) = value;
     return value;
 }
 
-std::any Interpreter::visit_literal_expr(LiteralExpr& expr) {
-    if (expr.value.type == TokenType::NUMBER) return std::stod(expr.value.lexeme);
-    if (expr.value.type == TokenType::STRING) return expr.value.lexeme;
-    if (expr.value.type == TokenType::TRUE) return true;
-    if (expr.value.type == TokenType::FALSE) return false;
-    return std::any();
+Value Interpreter::visit_call_expr(CallExpr& expr) {
+    Value callee = evaluate(*expr.callee);
+    size_t arguments = push_arguments(callee, expr);
+    return call(callee.as_function(), arguments);
+}
+
+size_t Interpreter::push_arguments(const Value& callee, CallExpr& expr) {
+    if (!callee.is_function()) throw std::runtime_error("Can only call functions.");
+    int arity = callee.as_function()->arity;
+    if (static_cast<size_t>(arity) != expr.arguments.size()) {
+        throw std::runtime_error("Expected " + std::to_string(arity) + " arguments but got " +
+                                 std::to_string(expr.arguments.size()) + ".");
+    }
+    locals.push(callee);
+    size_t first = locals.size();
+    for (Expr* argument : expr.arguments) locals.push(evaluate(*argument));
+    return first;
+}
+
+Value Interpreter::call(ObjFunction* function, size_t arguments) {
+    XERITH_STATS_COUNT(CALLS, 1);
+    if (function->kind == FunctionKind::NATIVE) {
+        Value result = static_cast<NativeFunction*>(function)->function(&locals[arguments]);
+        locals.leave(arguments - 1);
+        return result;
+    }
+    if (call_depth == MAX_CALL_DEPTH) throw std::runtime_error("Stack overflow.");
+    call_depth++;
+    if (profiler != nullptr) profiler->enter(function->name->chars.c_str());
+
+    size_t caller_base = locals.base;
+    const Value* caller_upvalues = upvalues;
+    for (;;) {
+        auto* closure = static_cast<InterpretedFunction*>(function);
+        FunctionStmt* declaration = closure->declaration;
+        locals.base = arguments;
+        upvalues = closure->upvalues.data();
+        locals.enter(declaration->slot_count - function->arity);
+        for (int slot : declaration->boxed_params) {
+            Value& parameter = locals.at(slot);
+            parameter = Value(Heap::make<ObjUpvalue>(std::move(parameter)));
+        }
+        if (!declaration->boxed_params.empty()) Heap::safepoint();
+        for (Stmt* statement : declaration->body) {
+            execute(*statement);
+            if (returning) break;
+        }
+        returning = false;
+        if (tail_callee.is_nil()) break;
+
+        // Tail call: the new arguments replace this frame's slots and the
+        // callee's body runs in it, without growing the C++ stack.
+        XERITH_STATS_COUNT(CALLS, 1);
+        locals.leave(arguments);
+        locals[arguments - 1] = std::move(tail_callee);
+        function = locals[arguments - 1].as_function();
+        for (Value& argument : tail_arguments) locals.push(std::move(argument));
+        tail_arguments.clear();
+        if (profiler != nullptr) {
+            profiler->leave();
+            profiler->enter(function->name->chars.c_str());
+        }
+    }
+
+    Value result = std::move(return_value);
+    return_value = Value();
+    locals.leave(arguments - 1);
+    locals.base = caller_base;
+    upvalues = caller_upvalues;
+    call_depth--;
+    if (profiler != nullptr) profiler->leave();
+    return result;
 }
 
-std::any Interpreter::visit_grouping_expr(GroupingExpr& expr) { return evaluate(*expr.expression); }
+Value Interpreter::visit_literal_expr(LiteralExpr& expr) { return expr.constant; }
+
+Value Interpreter::visit_grouping_expr(GroupingExpr& expr) { return evaluate(*expr.expression); }
 
-std::any Interpreter::visit_unary_expr(UnaryExpr& expr) {
-    std::any right = evaluate(*expr.right);
-    if (expr.op.type == TokenType::MINUS) return -std::any_cast<double>(right);
-    if (expr.op.type == TokenType::BANG) return !is_truthy(right);
-    return std::any();
+Value Interpreter::visit_unary_expr(UnaryExpr& expr) {
+    Value right = evaluate(*expr.right);
+    switch (expr.op.type) {
+        case TokenType::MINUS:
+            check_number_operand(right);
+            return -right.as_number();
+        case TokenType::BANG: return !is_truthy(right);
+        default: break;
+    }
+    return Value();
 }
 
-std::any Interpreter::visit_binary_expr(BinaryExpr& expr) {
-    std::any left = evaluate(*expr.left);
-    std::any right = evaluate(*expr.right);
+Value Interpreter::visit_binary_expr(BinaryExpr& expr) {
+    Value left = evaluate(*expr.left);
+    // Evaluating the right side may collect, and the collector only sees
+    // the stack.
+    bool rooted = left.is_obj();
+    if (rooted) locals.push(left);
+    Value right = evaluate(*expr.right);
+    if (rooted) locals.leave(locals.size() - 1);
     switch (expr.op.type) {
         case TokenType::PLUS:
-            if (left.type() == typeid(double)) return std::any_cast<double>(left) + std::any_cast<double>(right);
-            if (left.type() == typeid(std::string)) return std::any_cast<std::string>(left) + std::any_cast<std::string>(right);
-            break;
-        case TokenType::MINUS: return std::any_cast<double>(left) - std::any_cast<double>(right);
-        case TokenType::STAR: return std::any_cast<double>(left) * std::any_cast<double>(right);
-        case TokenType::SLASH: return std::any_cast<double>(left) / std::any_cast<double>(right);
-        case TokenType::GREATER: return std::any_cast<double>(left) > std::any_cast<double>(right);
-        case TokenType::GREATER_EQUAL: return std::any_cast<double>(left) >= std::any_cast<double>(right);
-        case TokenType::LESS: return std::any_cast<double>(left) < std::any_cast<double>(right);
-        case TokenType::LESS_EQUAL: return std::any_cast<double>(left) <= std::any_cast<double>(right);
-        case TokenType::EQUAL_EQUAL: return is_equal(left, right);
-        case TokenType::BANG_EQUAL: return !is_equal(left, right);
+            if (left.is_number() && right.is_number()) return left.as_number() + right.as_number();
+            if (left.is_string() && right.is_string()) return concat(left, right);
+            throw std::runtime_error("Operands must be two numbers or two strings.");
+        case TokenType::MINUS:
+            check_number_operands(left, right);
+            return left.as_number() - right.as_number();
+        case TokenType::STAR:
+            check_number_operands(left, right);
+            return left.as_number() * right.as_number();
+        case TokenType::SLASH:
+            check_number_operands(left, right);
+            return left.as_number() / right.as_number();
+        case TokenType::GREATER:
+            check_number_operands(left, right);
+            return left.as_number() > right.as_number();
+        case TokenType::GREATER_EQUAL:
+            check_number_operands(left, right);
+            return left.as_number() >= right.as_number();
+        case TokenType::LESS:
+            check_number_operands(left, right);
+            return left.as_number() < right.as_number();
+        case TokenType::LESS_EQUAL:
+            check_number_operands(left, right);
+            return left.as_number() <= right.as_number();
+        case TokenType::EQUAL_EQUAL: return values_equal(left, right);
+        case TokenType::BANG_EQUAL: return !values_equal(left, right);
         default: break;
     }
-    return std::any();
+    return Value();
 }
 
 }
\ No newline at end of file
@@ -3,46 +3,118 @@
 
 #include <memory>
 #include <vector>
-#include <any>
+#include "../jit/loop_jit.h"
 #include "../parser/ast.h"
 #include "environment.h"
+#include "heap.h"
+#include "profiler.h"
+#include "value.h"
 
 namespace xerith {
 
-class Interpreter : public ExprVisitor, public StmtVisitor {
+/**
+ * @brief A function declared in the tree; its body runs in place.
+ * The node lives in the caller's arena, which outlives every run.
+ * Each execution of the declaration makes a new one, holding the boxes
+ * of whatever it captures.
+ */
+struct InterpretedFunction : ObjFunction {
+    FunctionStmt* declaration;
+    std::vector<Value> upvalues;  // ObjUpvalue boxes, in `captures` order
+
+    explicit InterpretedFunction(FunctionStmt* declaration);
+
+    void trace(Tracer& tracer) const override;
+    size_t owned_bytes() const override { return upvalues.capacity() * sizeof(Value); }
+};
+
+/**
+ * @brief Tree-walking engine.
+ * Every value it holds across an allocation sits in `globals`, `locals`
+ * or one of its registers, which are the collector's roots; a callee
+ * waits in the slot below its arguments, as on the VM.
+ */
+class Interpreter : public ExprVisitor, public StmtVisitor, public RootSource {
 public:
+    // Deepest non-tail recursion before "Stack overflow."; each level
+    // costs a few C++ frames of the tree walk.
+    static constexpr int MAX_CALL_DEPTH = 2000;
+
     Interpreter();
-    void interpret(const std::vector<std::unique_ptr<Stmt>>& statements);
+    ~Interpreter();
+    // Returns false if a runtime error stopped the run.
+    bool interpret(const StmtList& statements);
+
+    // Lets hot numeric while loops run as native code (see LoopJit).
+    void enable_jit();
+
+    // Publishes each statement to `profiler` before running it; null stops.
+    void set_profiler(Profiler* profiler) { this->profiler = profiler; }
+
+    void trace_roots(Tracer& tracer) const override;
 
     // Stmt Visitor Methods
-    std::any visit_print_stmt(PrintStmt& stmt) override;
-    std::any visit_expression_stmt(ExpressionStmt& stmt) override;
-    std::any visit_var_stmt(VarStmt& stmt) override;
-    std::any visit_block_stmt(BlockStmt& stmt) override;
-    std::any visit_while_stmt(WhileStmt& stmt) override;
-    std::any visit_if_stmt(IfStmt& stmt) override;
+    void visit_print_stmt(PrintStmt& stmt) override;
+    void visit_expression_stmt(ExpressionStmt& stmt) override;
+    void visit_var_stmt(VarStmt& stmt) override;
+    void visit_block_stmt(BlockStmt& stmt) override;
+    void visit_while_stmt(WhileStmt& stmt) override;
+    void visit_if_stmt(IfStmt& stmt) override;
+    void visit_function_stmt(FunctionStmt& stmt) override;
+    void visit_return_stmt(ReturnStmt& stmt) override;
 
     // Expr Visitor Methods
-    std::any visit_binary_expr(BinaryExpr& expr) override;
-    std::any visit_unary_expr(UnaryExpr& expr) override;
-    std::any visit_literal_expr(LiteralExpr& expr) override;
-    std::any visit_grouping_expr(GroupingExpr& expr) override;
-    std::any visit_variable_expr(VariableExpr& expr) override;
-    std::any visit_assign_expr(AssignExpr& expr) override;
+    Value visit_binary_expr(BinaryExpr& expr) override;
+    Value visit_unary_expr(UnaryExpr& expr) override;
+    Value visit_literal_expr(LiteralExpr& expr) override;
+    Value visit_grouping_expr(GroupingExpr& expr) override;
+    Value visit_variable_expr(VariableExpr& expr) override;
+    Value visit_assign_expr(AssignExpr& expr) override;
+    Value visit_call_expr(CallExpr& expr) override;
 
     // Execution Helpers
-    void execute_block(const std::vector<std::unique_ptr<Stmt>>& statements, 
-                       std::shared_ptr<Environment> inner_env);
+    void execute_block(const StmtList& statements, size_t slot_count);
 
 private:
-    std::shared_ptr<Environment> environment;
+    Globals globals;
+    // Block locals and call frames share one stack; a call's arguments are
+    // its first slots, just above the callee.
+    ValueStack locals;
+    int call_depth = 0;
+    // A `return` sets `returning` and every statement loop stops; call()
+    // clears it. Nothing is thrown.
+    bool returning = false;
+    Value return_value;
+    // Set instead of `return_value` by `return f(...)`: call() reuses the
+    // frame for `tail_callee` with `tail_arguments` as its new arguments.
+    Value tail_callee;
+    std::vector<Value> tail_arguments;
+    // Upvalues of the function running now; null at top level.
+    const Value* upvalues = nullptr;
+    std::unique_ptr<LoopJit> jit;  // null unless enable_jit() was called
+    Profiler* profiler = nullptr;
     
     void execute(Stmt& stmt);
-    std::any evaluate(Expr& expr);
-    
+    Value evaluate(Expr& expr);
+
+    // Storage of a block-scoped variable: its slot, or the box in it.
+    Value& local(int slot, bool boxed) {
+        Value& value = locals.at(slot);
+        return boxed ? value.as_upvalue()->value : value;
+    }
+    Value& variable(const SymbolRef& target) {
+        if (target.is_upvalue()) return upvalues[target.upvalue].as_upvalue()->value;
+        return local(target.slot, target.boxed);
+    }
+
+    // Checks the callee and pushes it and the evaluated arguments; returns
+    // the stack index of the first argument.
+    size_t push_arguments(const Value& callee, CallExpr& expr);
+    Value call(ObjFunction* function, size_t arguments);
+
     // Evaluation Helpers
-    bool is_truthy(const std::any& value);
-    bool is_equal(const std::any& a, const std::any& b);
+    static void check_number_operand(const Value& operand);
+    static void check_number_operands(const Value& left, const Value& right);
 };
 
 } // namespace
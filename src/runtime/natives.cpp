@@ -0,0 +1,43 @@
+#include "natives.h"
+#include <chrono>
+#include <vector>
+
+namespace xerith {
+
+namespace {
+
+// Seconds since the process started; only differences are meaningful.
+Value clock_native(const Value*) {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Builtin {
+    const char* name;
+    int arity;
+    NativeFn function;
+};
+
+constexpr Builtin BUILTINS[] = {
+    {"clock", 0, clock_native},
+};
+
+} // namespace
+
+NativeFunction::NativeFunction(const char* name, int arity, NativeFn function)
+    : ObjFunction(FunctionKind::NATIVE, intern_pinned(name), arity), function(function) {}
+
+size_t native_count() { return sizeof(BUILTINS) / sizeof(BUILTINS[0]); }
+
+NativeFunction* native(size_t index) {
+    // Built on first use, so the names are interned after the string table exists.
+    static std::vector<NativeFunction> table = [] {
+        std::vector<NativeFunction> functions;
+        functions.reserve(native_count());
+        for (const Builtin& builtin : BUILTINS) functions.emplace_back(builtin.name, builtin.arity, builtin.function);
+        return functions;
+    }();
+    return &table[index];
+}
+
+} // namespace xerith
@@ -0,0 +1,30 @@
+#ifndef XERITH_NATIVES_H
+#define XERITH_NATIVES_H
+
+#include <cstddef>
+#include "value.h"
+
+namespace xerith {
+
+// Arguments arrive in a contiguous run of `arity` values.
+using NativeFn = Value (*)(const Value* args);
+
+/**
+ * @brief A builtin implemented in C++.
+ * Builtins are static objects outside the Heap, so the collector never
+ * frees them.
+ */
+struct NativeFunction : ObjFunction {
+    NativeFn function;
+
+    NativeFunction(const char* name, int arity, NativeFn function);
+};
+
+// Every program starts with these globals defined. The GlobalTable gives
+// them the first indices, in this order.
+size_t native_count();
+NativeFunction* native(size_t index);
+
+} // namespace xerith
+
+#endif // XERITH_NATIVES_H
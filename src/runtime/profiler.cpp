@@ -0,0 +1,181 @@
+#include "profiler.h"
+#include <signal.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include "../utils/source_manager.h"
+
+namespace xerith {
+
+namespace {
+
+std::atomic<Profiler*> running{nullptr};
+
+struct Line {
+    FileId file;
+    int line;
+
+    bool operator<(const Line& other) const {
+        return file != other.file ? file < other.file : line < other.line;
+    }
+};
+
+Line line_of(uint64_t location) {
+    Span span(static_cast<FileId>(location >> 32), static_cast<uint32_t>(location));
+    return {span.file, SourceManager::resolve(span).line};
+}
+
+std::string describe(const Line& line) {
+    if (line.file == 0) return "<unknown>";
+    return SourceManager::name(line.file) + ":" + std::to_string(line.line);
+}
+
+template <typename Key>
+std::vector<std::pair<Key, size_t>> by_count(const std::map<Key, size_t>& counts) {
+    std::vector<std::pair<Key, size_t>> sorted(counts.begin(), counts.end());
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    return sorted;
+}
+
+} // namespace
+
+Profiler::Profiler() : samples(new Sample[MAX_SAMPLES]) {}
+
+Profiler::~Profiler() { stop(); }
+
+void Profiler::on_signal(int) {
+    // Async-signal context: no allocation, no locks, no iostreams.
+    Profiler* profiler = running.load(std::memory_order_relaxed);
+    if (profiler == nullptr) return;
+    size_t n = profiler->sample_count.load(std::memory_order_relaxed);
+    if (n == MAX_SAMPLES) {
+        profiler->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    profiler->samples[n] = {profiler->location.load(std::memory_order_relaxed),
+                            profiler->frame.load(std::memory_order_relaxed)};
+    profiler->sample_count.store(n + 1, std::memory_order_relaxed);
+}
+
+void Profiler::start() {
+    if (frames.empty()) enter("<script>");
+    running.store(this);
+
+    struct sigaction action = {};
+    action.sa_handler = on_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    itimerval timer = {};
+    timer.it_interval.tv_usec = SAMPLE_INTERVAL_US;
+    timer.it_value.tv_usec = SAMPLE_INTERVAL_US;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+void Profiler::stop() {
+    if (running.load() != this) return;
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    running.store(nullptr);
+}
+
+void Profiler::enter(const char* function) {
+    int parent = frame.load(std::memory_order_relaxed);
+    // Frames are few and calls repeat, so a linear scan of the children
+    // seen so far stays cheap.
+    for (int i = parent + 1; i < static_cast<int>(frames.size()); i++) {
+        if (frames[i].parent == parent && frames[i].function == function) {
+            frame.store(i, std::memory_order_relaxed);
+            return;
+        }
+    }
+    frames.push_back({function, parent});
+    frame.store(static_cast<int>(frames.size()) - 1, std::memory_order_relaxed);
+}
+
+void Profiler::leave() {
+    int current = frame.load(std::memory_order_relaxed);
+    if (current >= 0) frame.store(frames[current].parent, std::memory_order_relaxed);
+}
+
+void Profiler::report(std::ostream& os) const {
+    size_t total = sample_count.load();
+    char row[128];
+    std::snprintf(row, sizeof(row), "== profile: %zu samples, %d us interval", total, SAMPLE_INTERVAL_US);
+    os << row;
+    if (size_t lost = dropped.load()) os << ", " << lost << " dropped";
+    os << " ==\n";
+    if (total == 0) return;
+
+    std::unordered_map<uint64_t, Line> lines_at;
+    std::map<Line, size_t> lines;
+    std::map<std::string, size_t> self;
+    std::map<std::string, size_t> inclusive;
+    for (size_t i = 0; i < total; i++) {
+        const Sample& sample = samples[i];
+        auto it = lines_at.find(sample.location);
+        if (it == lines_at.end()) it = lines_at.emplace(sample.location, line_of(sample.location)).first;
+        lines[it->second]++;
+
+        if (sample.frame < 0) continue;
+        self[frames[sample.frame].function]++;
+        // Recursion would otherwise count a function once per level.
+        std::vector<const char*> seen;
+        for (int f = sample.frame; f >= 0; f = frames[f].parent) {
+            const char* function = frames[f].function;
+            if (std::find(seen.begin(), seen.end(), function) != seen.end()) continue;
+            seen.push_back(function);
+            inclusive[function]++;
+        }
+    }
+
+    os << "-- lines --\n";
+    size_t shown = 0;
+    for (const auto& [line, count] : by_count(lines)) {
+        if (shown++ == 20) break;
+        std::snprintf(row, sizeof(row), "%8zu %5.1f%%  ", count, 100.0 * count / total);
+        os << row << describe(line);
+        if (line.file != 0) {
+            std::string_view text = SourceManager::line_text(line.file, line.line);
+            text.remove_prefix(std::min(text.find_first_not_of(" \t"), text.size()));
+            os << "  " << text;
+        }
+        os << "\n";
+    }
+
+    os << "-- functions --\n";
+    for (const auto& [function, count] : by_count(inclusive)) {
+        size_t own = self.count(function) ? self.at(function) : 0;
+        std::snprintf(row, sizeof(row), "%8zu %5.1f%% self %8zu %5.1f%% total  ",
+                      own, 100.0 * own / total, count, 100.0 * count / total);
+        os << row << function << "\n";
+    }
+}
+
+bool Profiler::write_folded(const std::string& path) const {
+    std::map<std::string, size_t> stacks;
+    std::unordered_map<uint64_t, std::string> leaves;
+    size_t total = sample_count.load();
+    for (size_t i = 0; i < total; i++) {
+        const Sample& sample = samples[i];
+        std::string stack;
+        for (int f = sample.frame; f >= 0; f = frames[f].parent) {
+            stack.insert(0, std::string(frames[f].function) + ";");
+        }
+        auto leaf = leaves.find(sample.location);
+        if (leaf == leaves.end()) leaf = leaves.emplace(sample.location, describe(line_of(sample.location))).first;
+        stacks[stack + leaf->second]++;
+    }
+
+    std::ofstream out(path);
+    if (!out) return false;
+    for (const auto& [stack, count] : stacks) out << stack << " " << count << "\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace xerith
@@ -0,0 +1,77 @@
+#ifndef XERITH_PROFILER_H
+#define XERITH_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../utils/span.h"
+
+namespace xerith {
+
+/**
+ * @brief SIGPROF sampling profiler behind `--profile`.
+ * The engines publish the statement or instruction they are about to run
+ * with at(), and function frames with enter()/leave(). The signal handler
+ * only copies the published location and frame into a preallocated
+ * buffer; everything is aggregated by report() after the run. Engines
+ * hold a null Profiler* when profiling is off, so the only cost then is
+ * one untaken branch per statement (the VM swaps dispatch tables instead).
+ */
+class Profiler {
+public:
+    static constexpr int SAMPLE_INTERVAL_US = 1000;
+    static constexpr size_t MAX_SAMPLES = size_t(1) << 20;
+
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Arms the CPU-time timer. Only one profiler can run at a time.
+    void start();
+    void stop();
+
+    void at(Span span) {
+        location.store((uint64_t(span.file) << 32) | span.offset, std::memory_order_relaxed);
+    }
+
+    // Frames nest; the script's top level is the "<script>" frame.
+    void enter(const char* function);
+    void leave();
+
+    // Hottest lines and functions, written to `os`.
+    void report(std::ostream& os) const;
+
+    // One "frame;frame;file:line count" line per distinct stack, the
+    // input format of flamegraph.pl and speedscope.
+    bool write_folded(const std::string& path) const;
+
+private:
+    // Call-tree node; a sample records the node that was on top.
+    struct Frame {
+        const char* function;
+        int parent;
+    };
+
+    struct Sample {
+        uint64_t location;
+        int frame;
+    };
+
+    static void on_signal(int);
+
+    std::vector<Frame> frames;
+    std::unique_ptr<Sample[]> samples;
+    std::atomic<uint64_t> location{0};
+    std::atomic<int> frame{-1};
+    std::atomic<size_t> sample_count{0};
+    std::atomic<size_t> dropped{0};
+};
+
+} // namespace xerith
+
+#endif // XERITH_PROFILER_H
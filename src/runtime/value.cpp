@@ -1 +1,173 @@
-// Will be written soon
+#include "value.h"
+#include <charconv>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace xerith {
+
+namespace {
+
+// Concatenations shorter than this are copied flat straight away; the
+// rope bookkeeping only pays off once copying the text gets expensive.
+constexpr size_t ROPE_THRESHOLD = 64;
+
+// Keys view each entry's own `chars`. The table holds no reference; a
+// string is erased when its last reference goes away.
+std::unordered_map<std::string_view, ObjString*>& string_table() {
+    static std::unordered_map<std::string_view, ObjString*> table;
+    return table;
+}
+
+} // namespace
+
+ObjString* intern(std::string_view chars) {
+    auto& table = string_table();
+    auto it = table.find(chars);
+    if (it != table.end()) {
+        retain_string(it->second);
+        return it->second;
+    }
+    return intern(std::string(chars));
+}
+
+ObjString* intern(std::string&& chars) {
+    auto& table = string_table();
+    auto it = table.find(chars);
+    if (it != table.end()) {
+        retain_string(it->second);
+        return it->second;
+    }
+
+    auto* string = new ObjString();
+    string->chars = std::move(chars);
+    string->length = string->chars.size();
+    string->interned = true;
+    table.emplace(string->chars, string);
+    return string;
+}
+
+ObjString* intern_pinned(std::string_view chars) {
+    // Lexers on loader threads pin concurrently; the interpreter and VM
+    // only run once loading is done, so intern() itself stays unlocked.
+    static std::mutex pin_mutex;
+    std::lock_guard<std::mutex> lock(pin_mutex);
+    // The first pin keeps the reference intern() just handed out.
+    ObjString* string = intern(chars);
+    // Written once, before any other thread can see the string as pinned.
+    if (!string->pinned) string->pinned = true;
+    return string;
+}
+
+void free_string(ObjString* string) {
+    // Ropes can be nested a million deep, so they are torn down with an
+    // explicit worklist rather than by recursion.
+    std::vector<ObjString*> pending;
+    while (string != nullptr) {
+        if (string->interned) string_table().erase(string->chars);
+        for (ObjString* child : {string->left, string->right, string->flat}) {
+            if (child != nullptr && !child->pinned && --child->refcount == 0) pending.push_back(child);
+        }
+        delete string;
+
+        if (pending.empty()) break;
+        string = pending.back();
+        pending.pop_back();
+    }
+}
+
+ObjString* ObjString::resolve() {
+    if (interned) return this;
+    if (flat != nullptr) return flat;
+
+    std::string text;
+    text.reserve(length);
+    std::vector<ObjString*> stack{this};
+    while (!stack.empty()) {
+        ObjString* node = stack.back();
+        stack.pop_back();
+        if (node->interned) text += node->chars;
+        else if (node->flat != nullptr) text += node->flat->chars;
+        else {
+            stack.push_back(node->right);
+            stack.push_back(node->left);
+        }
+    }
+
+    flat = intern(std::move(text));
+    if (left != nullptr) release_string(left);
+    if (right != nullptr) release_string(right);
+    left = right = nullptr;
+    return flat;
+}
+
+Value concat(const Value& a, const Value& b) {
+    ObjString* left = a.as_object();
+    ObjString* right = b.as_object();
+    if (right->length == 0) return a;
+    if (left->length == 0) return b;
+
+    size_t length = left->length + right->length;
+    if (length < ROPE_THRESHOLD) return Value(a.as_string() + b.as_string());
+
+    auto* rope = new ObjString();
+    rope->refcount = 0;  // the Value below takes the only reference
+    rope->length = length;
+    rope->left = left;
+    rope->right = right;
+    retain_string(left);
+    retain_string(right);
+    return Value(rope);
+}
+
+bool is_truthy(const Value& value) {
+    if (value.is_nil()) return false;
+    if (value.is_bool()) return value.as_bool();
+    return true;
+}
+
+bool values_equal(const Value& a, const Value& b) {
+    if (a.get_type() != b.get_type()) return false;
+    switch (a.get_type()) {
+        case ValueType::NIL:    return true;
+        case ValueType::BOOL:   return a.as_bool() == b.as_bool();
+        case ValueType::NUMBER: return a.as_number() == b.as_number();
+        case ValueType::STRING:
+            // Flat strings are interned, so equal text means the same object.
+            if (a.as_object()->length != b.as_object()->length) return false;
+            return a.as_object()->resolve() == b.as_object()->resolve();
+        case ValueType::FUNCTION: return a.as_function() == b.as_function();
+        case ValueType::UPVALUE:  return a.as_upvalue() == b.as_upvalue();
+    }
+    return false;
+}
+
+double parse_number(std::string_view lexeme) {
+    double number = 0;
+    std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), number);
+    return number;
+}
+
+std::string to_string(const Value& value) {
+    switch (value.get_type()) {
+        case ValueType::NIL:    return "nil";
+        case ValueType::BOOL:   return value.as_bool() ? "true" : "false";
+        case ValueType::STRING: return value.as_string();
+        case ValueType::FUNCTION: {
+            const ObjFunction* function = value.as_function();
+            if (function->kind == FunctionKind::NATIVE) return "<native fn>";
+            return "<fn " + function->name->chars + ">";
+        }
+        case ValueType::UPVALUE: return "<upvalue>";
+        case ValueType::NUMBER: {
+            // Match the default ostream formatting used by `print`.
+            std::ostringstream ss;
+            ss << value.as_number();
+            return ss.str();
+        }
+    }
+    return "nil";
+}
+
+} // namespace xerith
@@ -1 +1,225 @@
-// Will be written soon
+#ifndef XERITH_VALUE_H
+#define XERITH_VALUE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace xerith {
+
+// Collected heap types come last, so "is it an Obj" is one comparison.
+enum class ValueType : uint8_t {
+    NIL, BOOL, NUMBER, STRING, FUNCTION,
+    UPVALUE  // a captured variable's box; only ever held in a slot or a closure
+};
+
+/**
+ * @brief Heap payload for string values.
+ * Strings are immutable once created, so copies of a Value share one
+ * ObjString and only bump the (non-atomic) reference count.
+ *
+ * A string is either flat or a rope. Every flat string is interned, so
+ * two flat strings are equal exactly when they are the same object. A
+ * rope is the lazy concatenation `left + right`; the first read builds
+ * the flat text, interns it into `flat` and lets go of both halves.
+ */
+struct ObjString {
+    uint32_t refcount = 1;        // ignored once pinned
+    bool interned = false;
+    bool pinned = false;          // never freed, never counted again
+    size_t length = 0;
+    std::string chars;            // flat strings only
+
+    ObjString* left = nullptr;    // rope halves, until flattened
+    ObjString* right = nullptr;
+    ObjString* flat = nullptr;    // interned text of a flattened rope
+
+    // The interned flat string with this text, flattening a rope if needed.
+    ObjString* resolve();
+};
+
+// Returns the interned string for `chars`, carrying one new reference.
+ObjString* intern(std::string_view chars);
+ObjString* intern(std::string&& chars);
+
+// Interns `chars` for good and returns it without a new reference. Used
+// for identifiers and string literals, which tokens and the AST refer to
+// for as long as the process runs. Safe to call from several threads at
+// once, as long as nothing else is interning meanwhile (see ModuleLoader).
+ObjString* intern_pinned(std::string_view chars);
+
+// Drops the last reference; ropes are torn down iteratively.
+void free_string(ObjString* string);
+
+// Pinned strings are never written to after pinning, so front-end threads
+// can share literal Values without racing on the count.
+inline void retain_string(ObjString* string) {
+    if (!string->pinned) string->refcount++;
+}
+
+inline void release_string(ObjString* string) {
+    if (!string->pinned && --string->refcount == 0) free_string(string);
+}
+
+enum class FunctionKind : uint8_t {
+    NATIVE,       // NativeFunction, a builtin such as clock()
+    INTERPRETED,  // InterpretedFunction, run by the tree-walker
+    COMPILED,     // CompiledFunction, run by the VM
+    CLOSURE       // Closure, a CompiledFunction plus its captured upvalues
+};
+
+class Tracer;
+
+/**
+ * @brief Base of the heap objects other than strings.
+ * These can refer to each other in cycles (a closure captures the box
+ * holding itself), so they are not counted: Heap::make allocates them
+ * and the collector frees whatever its roots no longer reach.
+ */
+struct Obj {
+    Obj* next = nullptr;     // the heap's list of every object it allocated
+    uint32_t owned = 0;      // owned_bytes() when the heap last counted it
+    uint16_t cell = 0;       // bytes the heap gave it; 0 for a static object
+    mutable bool marked = false;
+
+    virtual ~Obj() = default;
+
+    // Marks every object this one refers to.
+    virtual void trace(Tracer&) const {}
+    // Memory the object allocated for itself, such as a function's
+    // bytecode or a closure's upvalues, which the heap counts with it.
+    virtual size_t owned_bytes() const { return 0; }
+};
+
+/**
+ * @brief Heap payload for function values.
+ * Each engine subclasses it with whatever it needs to run the body and
+ * tells them apart by `kind`, so calls never need a dynamic_cast.
+ */
+struct ObjFunction : Obj {
+    FunctionKind kind;
+    int arity = 0;
+    ObjString* name = nullptr;  // pinned identifier
+
+    ObjFunction(FunctionKind kind, ObjString* name, int arity) : kind(kind), arity(arity), name(name) {}
+};
+
+struct ObjUpvalue;
+
+/**
+ * @brief A 16-byte tagged runtime value.
+ * Numbers and booleans live inline; strings are counted references, and
+ * functions and upvalues plain pointers to collected objects.
+ */
+class Value {
+public:
+    Value() : type(ValueType::NIL) { as.number = 0; }
+    Value(bool boolean) : type(ValueType::BOOL) { as.number = 0; as.boolean = boolean; }
+    Value(double number) : type(ValueType::NUMBER) { as.number = number; }
+    Value(std::string chars) : type(ValueType::STRING) { as.string = intern(std::move(chars)); }
+    // Shares an existing string, taking a new reference to it.
+    explicit Value(ObjString* string) : type(ValueType::STRING) { as.string = string; retain(); }
+    explicit Value(ObjFunction* function) : type(ValueType::FUNCTION) { as.obj = function; }
+    inline explicit Value(ObjUpvalue* upvalue);
+
+    // A string literal would otherwise silently convert to bool.
+    Value(const char*) = delete;
+
+    Value(const Value& other) : type(other.type), as(other.as) { retain(); }
+    Value(Value&& other) noexcept : type(other.type), as(other.as) { other.type = ValueType::NIL; }
+    ~Value() { release(); }
+
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            Value copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            type = other.type;
+            as = other.as;
+            other.type = ValueType::NIL;
+        }
+        return *this;
+    }
+
+    ValueType get_type() const { return type; }
+    bool is_nil() const { return type == ValueType::NIL; }
+    bool is_bool() const { return type == ValueType::BOOL; }
+    bool is_number() const { return type == ValueType::NUMBER; }
+    bool is_string() const { return type == ValueType::STRING; }
+    bool is_function() const { return type == ValueType::FUNCTION; }
+    bool is_upvalue() const { return type == ValueType::UPVALUE; }
+    bool is_obj() const { return type > ValueType::STRING; }
+
+    bool as_bool() const { return as.boolean; }
+    double as_number() const { return as.number; }
+    const std::string& as_string() const { return as.string->resolve()->chars; }
+    ObjString* as_object() const { return as.string; }
+    ObjFunction* as_function() const { return static_cast<ObjFunction*>(as.obj); }
+    inline ObjUpvalue* as_upvalue() const;
+    Obj* as_obj() const { return as.obj; }
+
+private:
+    void retain() const {
+        if (type == ValueType::STRING) retain_string(as.string);
+    }
+
+    void release() {
+        if (type == ValueType::STRING) release_string(as.string);
+    }
+
+    void swap(Value& other) noexcept {
+        std::swap(type, other.type);
+        std::swap(as, other.as);
+    }
+
+    ValueType type;
+    union {
+        bool boolean;
+        double number;
+        ObjString* string;
+        Obj* obj;  // FUNCTION and UPVALUE
+    } as;
+};
+
+static_assert(sizeof(Value) == 16, "Value should stay two machine words");
+
+/**
+ * @brief Heap box for a variable that a closure captures.
+ * The declaring frame's slot and every closure over the variable hold
+ * the same box, so it lives as long as the longest of them; variables
+ * nothing captures never get one.
+ */
+struct ObjUpvalue : Obj {
+    Value value;
+
+    explicit ObjUpvalue(Value value) : value(std::move(value)) {}
+
+    void trace(Tracer& tracer) const override;
+};
+
+inline Value::Value(ObjUpvalue* upvalue) : type(ValueType::UPVALUE) { as.obj = upvalue; }
+
+inline ObjUpvalue* Value::as_upvalue() const { return static_cast<ObjUpvalue*>(as.obj); }
+
+bool is_truthy(const Value& value);
+bool values_equal(const Value& a, const Value& b);
+
+// String `+`. Long results become ropes, so building a string up one
+// piece at a time stays linear.
+Value concat(const Value& a, const Value& b);
+
+// Decodes a NUMBER lexeme.
+double parse_number(std::string_view lexeme);
+
+// Formats a value the way `print` shows it.
+std::string to_string(const Value& value);
+
+} // namespace xerith
+
+#endif // XERITH_VALUE_H
@@ -0,0 +1,179 @@
+#include "constant_folder.h"
+
+namespace xerith {
+
+namespace {
+
+// Mirrors Interpreter::visit_binary_expr, but reports failure instead of
+// throwing so ill-typed constant expressions are left for runtime.
+bool fold_binary(TokenType op, const Value& left, const Value& right, Value& out) {
+    if (op == TokenType::EQUAL_EQUAL) { out = values_equal(left, right); return true; }
+    if (op == TokenType::BANG_EQUAL) { out = !values_equal(left, right); return true; }
+
+    if (op == TokenType::PLUS && left.is_string() && right.is_string()) {
+        out = concat(left, right);
+        return true;
+    }
+    if (!left.is_number() || !right.is_number()) return false;
+
+    double a = left.as_number();
+    double b = right.as_number();
+    switch (op) {
+        case TokenType::PLUS:          out = a + b; return true;
+        case TokenType::MINUS:         out = a - b; return true;
+        case TokenType::STAR:          out = a * b; return true;
+        case TokenType::SLASH:         out = a / b; return true;
+        case TokenType::GREATER:       out = a > b; return true;
+        case TokenType::GREATER_EQUAL: out = a >= b; return true;
+        case TokenType::LESS:          out = a < b; return true;
+        case TokenType::LESS_EQUAL:    out = a <= b; return true;
+        default:                       return false;
+    }
+}
+
+TokenType literal_type(const Value& value) {
+    switch (value.get_type()) {
+        case ValueType::NUMBER: return TokenType::NUMBER;
+        case ValueType::STRING: return TokenType::STRING;
+        case ValueType::BOOL:   return value.as_bool() ? TokenType::TRUE : TokenType::FALSE;
+        case ValueType::NIL:    return TokenType::NIL;
+        case ValueType::FUNCTION:
+        case ValueType::UPVALUE: break;  // never literals
+    }
+    return TokenType::NIL;
+}
+
+} // namespace
+
+ConstantFolder::ConstantFolder(Arena& arena) : arena(arena) {}
+
+void ConstantFolder::fold(StmtList& statements) {
+    size_t kept = 0;
+    for (Stmt* statement : statements) {
+        if (Stmt* result = fold(statement)) statements.items[kept++] = result;
+    }
+    statements.count = kept;
+}
+
+Expr* ConstantFolder::fold(Expr* expr) {
+    if (expr == nullptr) return nullptr;
+    expr->accept(*this);
+    Expr* result = folded_expr != nullptr ? folded_expr : expr;
+    folded_expr = nullptr;
+    return result;
+}
+
+Stmt* ConstantFolder::fold(Stmt* stmt) {
+    stmt->accept(*this);
+    Stmt* result = stmt_folded ? folded_stmt : stmt;
+    stmt_folded = false;
+    folded_stmt = nullptr;
+    return result;
+}
+
+LiteralExpr* ConstantFolder::make_literal(const Token& origin, Value constant) {
+    // Runtime errors and disassembly still point at the operator that produced it.
+    Token token(literal_type(constant), "", origin.span);
+    return arena.construct<LiteralExpr>(token, std::move(constant));
+}
+
+void ConstantFolder::visit_print_stmt(PrintStmt& stmt) {
+    stmt.expression = fold(stmt.expression);
+}
+
+void ConstantFolder::visit_expression_stmt(ExpressionStmt& stmt) {
+    stmt.expression = fold(stmt.expression);
+}
+
+void ConstantFolder::visit_var_stmt(VarStmt& stmt) {
+    stmt.initializer = fold(stmt.initializer);
+}
+
+void ConstantFolder::visit_block_stmt(BlockStmt& stmt) {
+    fold(stmt.statements);
+}
+
+void ConstantFolder::visit_while_stmt(WhileStmt& stmt) {
+    stmt.condition = fold(stmt.condition);
+    Stmt* body = fold(stmt.body);
+    stmt.body = body != nullptr ? body : arena.construct<BlockStmt>(StmtList{});
+}
+
+void ConstantFolder::visit_if_stmt(IfStmt& stmt) {
+    stmt.condition = fold(stmt.condition);
+    Stmt* then_branch = fold(stmt.then_branch);
+    Stmt* else_branch = stmt.else_branch != nullptr ? fold(stmt.else_branch) : nullptr;
+
+    if (auto* literal = dynamic_cast<LiteralExpr*>(stmt.condition)) {
+        // Branches never open a scope of their own, so the surviving one
+        // can stand in for the whole statement.
+        folded_stmt = is_truthy(literal->constant) ? then_branch : else_branch;
+        stmt_folded = true;
+        return;
+    }
+
+    stmt.then_branch = then_branch != nullptr ? then_branch : arena.construct<BlockStmt>(StmtList{});
+    stmt.else_branch = else_branch;
+}
+
+void ConstantFolder::visit_function_stmt(FunctionStmt& stmt) {
+    fold(stmt.body);
+}
+
+void ConstantFolder::visit_return_stmt(ReturnStmt& stmt) {
+    // Calls never fold, so `tail_call` stays valid.
+    stmt.value = fold(stmt.value);
+}
+
+Value ConstantFolder::visit_binary_expr(BinaryExpr& expr) {
+    expr.left = fold(expr.left);
+    expr.right = fold(expr.right);
+
+    auto* left = dynamic_cast<LiteralExpr*>(expr.left);
+    auto* right = dynamic_cast<LiteralExpr*>(expr.right);
+    Value result;
+    if (left && right && fold_binary(expr.op.type, left->constant, right->constant, result)) {
+        folded_expr = make_literal(expr.op, std::move(result));
+    }
+    return Value();
+}
+
+Value ConstantFolder::visit_unary_expr(UnaryExpr& expr) {
+    expr.right = fold(expr.right);
+
+    auto* operand = dynamic_cast<LiteralExpr*>(expr.right);
+    if (operand == nullptr) return Value();
+    if (expr.op.type == TokenType::BANG) {
+        folded_expr = make_literal(expr.op, Value(!is_truthy(operand->constant)));
+    } else if (expr.op.type == TokenType::MINUS && operand->constant.is_number()) {
+        folded_expr = make_literal(expr.op, Value(-operand->constant.as_number()));
+    }
+    return Value();
+}
+
+Value ConstantFolder::visit_literal_expr(LiteralExpr&) {
+    return Value();
+}
+
+Value ConstantFolder::visit_grouping_expr(GroupingExpr& expr) {
+    expr.expression = fold(expr.expression);
+    if (dynamic_cast<LiteralExpr*>(expr.expression) != nullptr) folded_expr = expr.expression;
+    return Value();
+}
+
+Value ConstantFolder::visit_variable_expr(VariableExpr&) {
+    return Value();
+}
+
+Value ConstantFolder::visit_assign_expr(AssignExpr& expr) {
+    expr.value = fold(expr.value);
+    return Value();
+}
+
+Value ConstantFolder::visit_call_expr(CallExpr& expr) {
+    expr.callee = fold(expr.callee);
+    for (Expr*& argument : expr.arguments) argument = fold(argument);
+    return Value();
+}
+
+} // namespace xerith
@@ -0,0 +1,61 @@
+#ifndef XERITH_CONSTANT_FOLDER_H
+#define XERITH_CONSTANT_FOLDER_H
+
+#include "../parser/ast.h"
+#include "../utils/arena.h"
+
+namespace xerith {
+
+/**
+ * @brief AST optimisation pass run between parsing and resolution.
+ * Collapses Binary/Unary/Grouping subtrees whose operands are all literals
+ * into a single LiteralExpr, and replaces an IfStmt whose condition folds
+ * to a constant with the branch that would run. Expressions that would
+ * raise a runtime error (e.g. `-"a"`) are left alone so the error still
+ * surfaces at the same point. Replacement nodes come from `arena`.
+ */
+class ConstantFolder : public ExprVisitor, public StmtVisitor {
+public:
+    explicit ConstantFolder(Arena& arena);
+
+    // Rewrites `statements` in place; dropped statements shrink the list.
+    void fold(StmtList& statements);
+
+    // Stmt Visitor Methods
+    void visit_print_stmt(PrintStmt& stmt) override;
+    void visit_expression_stmt(ExpressionStmt& stmt) override;
+    void visit_var_stmt(VarStmt& stmt) override;
+    void visit_block_stmt(BlockStmt& stmt) override;
+    void visit_while_stmt(WhileStmt& stmt) override;
+    void visit_if_stmt(IfStmt& stmt) override;
+    void visit_function_stmt(FunctionStmt& stmt) override;
+    void visit_return_stmt(ReturnStmt& stmt) override;
+
+    // Expr Visitor Methods. The returned Value is unused; a visit that
+    // replaces its node stores the replacement in `folded_expr` instead.
+    Value visit_binary_expr(BinaryExpr& expr) override;
+    Value visit_unary_expr(UnaryExpr& expr) override;
+    Value visit_literal_expr(LiteralExpr& expr) override;
+    Value visit_grouping_expr(GroupingExpr& expr) override;
+    Value visit_variable_expr(VariableExpr& expr) override;
+    Value visit_assign_expr(AssignExpr& expr) override;
+    Value visit_call_expr(CallExpr& expr) override;
+
+private:
+    // Each returns the node to use in place of its argument; a statement
+    // may fold away to nullptr.
+    Expr* fold(Expr* expr);
+    Stmt* fold(Stmt* stmt);
+
+    LiteralExpr* make_literal(const Token& origin, Value constant);
+
+    Arena& arena;
+    Expr* folded_expr = nullptr;
+    // Separate flag because a statement can legitimately fold to nullptr.
+    Stmt* folded_stmt = nullptr;
+    bool stmt_folded = false;
+};
+
+} // namespace xerith
+
+#endif // XERITH_CONSTANT_FOLDER_H
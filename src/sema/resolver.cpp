@@ -1 +1,107 @@
-// Will be written soon
+#include "resolver.h"
+
+namespace xerith {
+
+Resolver::Resolver(GlobalTable& globals) : globals(globals) {}
+
+void Resolver::resolve(const StmtList& statements) {
+    for (Stmt* statement : statements) resolve(*statement);
+}
+
+void Resolver::resolve(Stmt& stmt) { stmt.accept(*this); }
+void Resolver::resolve(Expr& expr) { expr.accept(*this); }
+
+void Resolver::visit_print_stmt(PrintStmt& stmt) {
+    resolve(*stmt.expression);
+}
+
+void Resolver::visit_expression_stmt(ExpressionStmt& stmt) {
+    resolve(*stmt.expression);
+}
+
+void Resolver::visit_var_stmt(VarStmt& stmt) {
+    // The initializer still sees any outer binding of the same name.
+    if (stmt.initializer != nullptr) resolve(*stmt.initializer);
+    if (!symbols.at_global_scope()) stmt.slot = symbols.declare(stmt.name.lexeme, &stmt.boxed);
+    else stmt.global = globals.slot(stmt.name.interned);
+}
+
+void Resolver::visit_block_stmt(BlockStmt& stmt) {
+    symbols.push_scope();
+    resolve(stmt.statements);
+    stmt.slot_count = symbols.pop_scope();
+}
+
+void Resolver::visit_while_stmt(WhileStmt& stmt) {
+    resolve(*stmt.condition);
+    resolve(*stmt.body);
+}
+
+void Resolver::visit_if_stmt(IfStmt& stmt) {
+    resolve(*stmt.condition);
+    resolve(*stmt.then_branch);
+    if (stmt.else_branch != nullptr) resolve(*stmt.else_branch);
+}
+
+void Resolver::visit_function_stmt(FunctionStmt& stmt) {
+    // Declared before the body is resolved, so a global function can call itself.
+    if (!symbols.at_global_scope()) stmt.slot = symbols.declare(stmt.name.lexeme, &stmt.boxed);
+    else stmt.global = globals.slot(stmt.name.interned);
+
+    symbols.push_function();
+    for (Token* param : stmt.params) symbols.declare(param->lexeme, nullptr);
+    resolve(stmt.body);
+    // Parameters are distinct, so parameter i is slot i.
+    for (int slot = 0; slot < static_cast<int>(stmt.params.size()); slot++) {
+        if (symbols.is_captured(slot)) stmt.boxed_params.push_back(slot);
+    }
+    stmt.slot_count = symbols.pop_function(stmt.captures);
+}
+
+void Resolver::visit_return_stmt(ReturnStmt& stmt) {
+    if (stmt.value != nullptr) resolve(*stmt.value);
+}
+
+Value Resolver::visit_binary_expr(BinaryExpr& expr) {
+    resolve(*expr.left);
+    resolve(*expr.right);
+    return Value();
+}
+
+Value Resolver::visit_unary_expr(UnaryExpr& expr) {
+    resolve(*expr.right);
+    return Value();
+}
+
+Value Resolver::visit_literal_expr(LiteralExpr&) {
+    return Value();
+}
+
+Value Resolver::visit_grouping_expr(GroupingExpr& expr) {
+    resolve(*expr.expression);
+    return Value();
+}
+
+Value Resolver::visit_variable_expr(VariableExpr& expr) {
+    bind(expr.name, expr.target);
+    return Value();
+}
+
+Value Resolver::visit_assign_expr(AssignExpr& expr) {
+    resolve(*expr.value);
+    bind(expr.name, expr.target);
+    return Value();
+}
+
+Value Resolver::visit_call_expr(CallExpr& expr) {
+    resolve(*expr.callee);
+    for (Expr* argument : expr.arguments) resolve(*argument);
+    return Value();
+}
+
+void Resolver::bind(const Token& name, SymbolRef& target) {
+    target = symbols.resolve(name.lexeme, &target.boxed);
+    if (target.is_global()) target.global = globals.slot(name.interned);
+}
+
+} // namespace xerith
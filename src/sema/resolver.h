@@ -1 +1,58 @@
-// Will be written soon
+#ifndef XERITH_RESOLVER_H
+#define XERITH_RESOLVER_H
+
+#include <vector>
+#include "../parser/ast.h"
+#include "symbols.h"
+
+namespace xerith {
+
+/**
+ * @brief Static scope pass run between parsing and execution.
+ * Gives every block-scoped variable a frame slot and every global an
+ * index in `globals`, and annotates each VariableExpr/AssignExpr with
+ * the one it refers to, so the Interpreter never looks a name up.
+ * A function body is a frame of its own, numbered from its first
+ * parameter; names from an enclosing function's frame become upvalues,
+ * and only the variables captured that way are boxed.
+ */
+class Resolver : public ExprVisitor, public StmtVisitor {
+public:
+    explicit Resolver(GlobalTable& globals);
+
+    void resolve(const StmtList& statements);
+
+    // Stmt Visitor Methods
+    void visit_print_stmt(PrintStmt& stmt) override;
+    void visit_expression_stmt(ExpressionStmt& stmt) override;
+    void visit_var_stmt(VarStmt& stmt) override;
+    void visit_block_stmt(BlockStmt& stmt) override;
+    void visit_while_stmt(WhileStmt& stmt) override;
+    void visit_if_stmt(IfStmt& stmt) override;
+    void visit_function_stmt(FunctionStmt& stmt) override;
+    void visit_return_stmt(ReturnStmt& stmt) override;
+
+    // Expr Visitor Methods. The returned Value is unused.
+    Value visit_binary_expr(BinaryExpr& expr) override;
+    Value visit_unary_expr(UnaryExpr& expr) override;
+    Value visit_literal_expr(LiteralExpr& expr) override;
+    Value visit_grouping_expr(GroupingExpr& expr) override;
+    Value visit_variable_expr(VariableExpr& expr) override;
+    Value visit_assign_expr(AssignExpr& expr) override;
+    Value visit_call_expr(CallExpr& expr) override;
+
+private:
+    void resolve(Stmt& stmt);
+    void resolve(Expr& expr);
+
+    // Points `target` at `name`. Its `boxed` flag may be set later, once
+    // the scope declaring the name has closed.
+    void bind(const Token& name, SymbolRef& target);
+
+    SymbolTable symbols;
+    GlobalTable& globals;
+};
+
+} // namespace xerith
+
+#endif // XERITH_RESOLVER_H
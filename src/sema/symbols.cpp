@@ -1 +1,115 @@
-// Will be written soon
+#include "symbols.h"
+#include <algorithm>
+#include "../runtime/natives.h"
+
+namespace xerith {
+
+GlobalTable::GlobalTable() {
+    for (size_t i = 0; i < native_count(); i++) slot(native(i)->name);
+}
+
+int GlobalTable::slot(const ObjString* name) {
+    return slots.emplace(name, static_cast<int>(slots.size())).first->second;
+}
+
+int Scope::declare(std::string_view name, int id) {
+    auto it = slots.find(name);
+    if (it != slots.end()) return it->second;
+    int slot = end();
+    slots.emplace(name, slot);
+    ids.push_back(id);
+    return slot;
+}
+
+int Scope::lookup(std::string_view name) const {
+    auto it = slots.find(name);
+    return it != slots.end() ? it->second : -1;
+}
+
+SymbolTable::SymbolTable() : frames{{0, {}}} {}
+
+void SymbolTable::push_scope() {
+    bool frame_start = frames.back().first_scope == scopes.size();
+    scopes.emplace_back(frame_start ? 0 : scopes.back().end());
+}
+
+int SymbolTable::pop_scope() {
+    int count = scopes.back().slot_count();
+    scopes.pop_back();
+    if (scopes.empty()) {
+        // No variable seen so far can be captured any more.
+        for (const Use& use : uses) {
+            if (captured[use.local]) *use.boxed = true;
+        }
+        uses.clear();
+        captured.clear();
+    }
+    return count;
+}
+
+void SymbolTable::push_function() {
+    frames.push_back({scopes.size(), {}});
+    push_scope();
+}
+
+int SymbolTable::pop_function(std::vector<Capture>& captures) {
+    captures = std::move(frames.back().captures);
+    frames.pop_back();
+    return pop_scope();
+}
+
+int SymbolTable::declare(std::string_view name, bool* boxed) {
+    Scope& scope = scopes.back();
+    int slot = scope.declare(name, static_cast<int>(captured.size()));
+    if (scope.id(slot) == static_cast<int>(captured.size())) captured.push_back(false);
+    use(scope.id(slot), boxed);
+    return slot;
+}
+
+SymbolRef SymbolTable::resolve(std::string_view name, bool* boxed) {
+    for (size_t i = scopes.size(); i-- > frames.back().first_scope;) {
+        int slot = scopes[i].lookup(name);
+        if (slot < 0) continue;
+        use(scopes[i].id(slot), boxed);
+        return SymbolRef{slot};
+    }
+    SymbolRef target;
+    target.upvalue = resolve_upvalue(frames.size() - 1, name);
+    // Upvalues are always boxed; a global's flag is never read.
+    target.boxed = target.is_upvalue();
+    return target;
+}
+
+bool SymbolTable::is_captured(int slot) const {
+    return captured[scopes.back().id(slot)];
+}
+
+int SymbolTable::resolve_upvalue(size_t frame, std::string_view name) {
+    if (frame == 0) return -1;
+    Capture capture{-1, true};
+    // The enclosing frame's scopes sit just below this frame's first one.
+    for (size_t i = frames[frame].first_scope; i-- > frames[frame - 1].first_scope;) {
+        int slot = scopes[i].lookup(name);
+        if (slot < 0) continue;
+        captured[scopes[i].id(slot)] = true;
+        capture = {slot, true};
+        break;
+    }
+    if (capture.index < 0) {
+        int index = resolve_upvalue(frame - 1, name);
+        if (index < 0) return -1;
+        capture = {index, false};
+    }
+
+    std::vector<Capture>& captures = frames[frame].captures;
+    auto it = std::find(captures.begin(), captures.end(), capture);
+    if (it != captures.end()) return static_cast<int>(it - captures.begin());
+    captures.push_back(capture);
+    return static_cast<int>(captures.size()) - 1;
+}
+
+void SymbolTable::use(int local, bool* boxed) {
+    if (boxed != nullptr) uses.push_back({local, boxed});
+}
+
+} // namespace xerith
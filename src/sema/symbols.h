@@ -1 +1,149 @@
-// Will be written soon
+#ifndef XERITH_SYMBOLS_H
+#define XERITH_SYMBOLS_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xerith {
+
+struct ObjString;
+
+/**
+ * @brief Where a name lives at runtime.
+ * Slots are numbered from the base of the frame, counting every block
+ * that encloses the declaration, so nested blocks share one flat frame.
+ * A name declared in an enclosing function's frame is instead one of
+ * the running closure's upvalues. A name found in neither is a global,
+ * and `global` is its index in the GlobalTable.
+ */
+struct SymbolRef {
+    int slot = -1;
+    int global = -1;
+    int upvalue = -1;    // index into the running closure's captures
+    bool boxed = false;  // the slot holds an ObjUpvalue some closure shares
+
+    bool is_global() const { return slot < 0 && upvalue < 0; }
+    bool is_upvalue() const { return upvalue >= 0; }
+};
+
+/**
+ * @brief How a closure finds one of its upvalues when it is created:
+ * a boxed slot of the frame creating it, or one of that frame's own
+ * upvalues, for names from further out.
+ */
+struct Capture {
+    int index;
+    bool local;
+
+    bool operator==(const Capture& other) const { return index == other.index && local == other.local; }
+};
+
+/**
+ * @brief Numbers every global name the first time the resolver sees it.
+ * The numbering only ever grows, so a table kept across REPL inputs
+ * gives a global the same index for the whole session. Keys are the
+ * lexer's pinned identifiers. The builtins come first, in natives.h order.
+ */
+class GlobalTable {
+public:
+    GlobalTable();
+
+    int slot(const ObjString* name);
+    int size() const { return static_cast<int>(slots.size()); }
+
+private:
+    std::unordered_map<const ObjString*, int> slots;
+};
+
+/**
+ * @brief Names declared so far in one block, mapped to frame slots.
+ * Each slot also carries the SymbolTable's id for its variable, which
+ * tracks whether a closure captures it.
+ */
+class Scope {
+public:
+    explicit Scope(int base) : base(base) {}
+
+    // Returns the slot for `name`, reusing it if the block already
+    // declared it; a new slot takes variable id `id`.
+    int declare(std::string_view name, int id);
+    int lookup(std::string_view name) const;
+    int id(int slot) const { return ids[slot - base]; }
+
+    // First slot past this block's own declarations.
+    int end() const { return base + slot_count(); }
+    int slot_count() const { return static_cast<int>(ids.size()); }
+
+private:
+    int base;
+    std::unordered_map<std::string_view, int> slots;
+    std::vector<int> ids;
+};
+
+/**
+ * @brief Stack of block scopes used by the resolver.
+ * The bottom of the stack is the innermost enclosing block of the
+ * top-level program; globals are never entered here. A function body
+ * starts a new frame: its scopes number slots from 0 again, and a name
+ * found in an enclosing frame becomes an upvalue of every function in
+ * between.
+ *
+ * That capture is the escape analysis. Only a captured variable has to
+ * outlive its slot, so only it is boxed; the rest stay plain slots. A
+ * capture can come after a variable's other uses have been resolved,
+ * so every use of a local hands over its SymbolRef::boxed flag (the
+ * declaration its own), and once the last scope closes the flags of
+ * captured variables are set.
+ */
+class SymbolTable {
+public:
+    SymbolTable();
+
+    void push_scope();
+    // Pops the innermost scope and returns how many slots it needed.
+    int pop_scope();
+
+    // Opens a frame whose first scope holds the parameters.
+    void push_function();
+    // Closes the innermost frame and returns how many slots its first
+    // scope needed; nested blocks reserve their own, as at top level.
+    // `captures` receives what a closure over it must capture.
+    int pop_function(std::vector<Capture>& captures);
+
+    bool at_global_scope() const { return scopes.empty(); }
+    // `boxed` is set later if a closure captures the variable.
+    int declare(std::string_view name, bool* boxed);
+    SymbolRef resolve(std::string_view name, bool* boxed);
+    // Whether a closure captures `slot` of the innermost scope.
+    bool is_captured(int slot) const;
+
+private:
+    struct Frame {
+        size_t first_scope;
+        std::vector<Capture> captures;
+    };
+
+    struct Use {
+        int local;
+        bool* boxed;
+    };
+
+    // Upvalue index of `name` in frames[frame], or -1 if no enclosing
+    // frame declares it.
+    int resolve_upvalue(size_t frame, std::string_view name);
+    void use(int local, bool* boxed);
+
+    std::vector<Scope> scopes;
+    // The top-level program is frames[0]; one more per open function.
+    std::vector<Frame> frames;
+    // Indexed by variable id, for every local since the last time
+    // no scope was open.
+    std::vector<bool> captured;
+    std::vector<Use> uses;
+};
+
+} // namespace xerith
+
+#endif // XERITH_SYMBOLS_H
@@ -7,6 +7,7 @@ namespace xerith {
 Arena::Arena(size_t chunk_size) : default_chunk_size(chunk_size) {}
 
 Arena::~Arena() {
+    run_finalizers();
     for (auto& chunk : chunks) {
         free(chunk.data);
     }
@@ -23,13 +24,91 @@ void* Arena::alloc(size_t size) {
     auto& last = chunks.back();
     void* ptr = last.data + last.used;
     last.used += size;
+    allocation_count++;
     return ptr;
 }
 
+void* Arena::alloc(size_t size, size_t align) {
+    size = (size + 7) & ~7;
+    // Alignment is of the address, not the offset: malloc only promises 16.
+    auto padding = [align](const Chunk& chunk) {
+        uintptr_t at = reinterpret_cast<uintptr_t>(chunk.data + chunk.used);
+        return static_cast<size_t>(-at & (align - 1));
+    };
+
+    if (chunks.empty() || chunks.back().used + padding(chunks.back()) + size > chunks.back().size) {
+        grow(size + align - 1);
+    }
+
+    auto& last = chunks.back();
+    last.used += padding(last);
+    void* ptr = last.data + last.used;
+    last.used += size;
+    allocation_count++;
+    return ptr;
+}
+
+void Arena::reset() {
+    rewind(Mark{});
+}
+
+Arena::Mark Arena::mark() const {
+    return {chunks.size(), chunks.empty() ? 0 : chunks.back().used, finalizers};
+}
+
+void Arena::rewind(const Mark& mark) {
+    run_finalizers(mark.finalizers);
+    if (chunks.empty()) return;
+
+    // A mark taken before the first chunk still keeps it, like reset().
+    size_t keep = std::max<size_t>(mark.chunk_count, 1);
+    for (size_t i = keep; i < chunks.size(); i++) {
+        free(chunks[i].data);
+    }
+    chunks.resize(keep);
+    chunks.back().used = mark.chunk_count == 0 ? 0 : mark.used;
+}
+
+size_t Arena::bytes_used() const {
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.used;
+    return total;
+}
+
+ArenaStats Arena::stats() const {
+    ArenaStats stats;
+    stats.allocations = allocation_count;
+    stats.chunks = chunks.size();
+    for (const auto& chunk : chunks) {
+        stats.bytes_used += chunk.used;
+        stats.bytes_reserved += chunk.size;
+    }
+    return stats;
+}
+
 void Arena::grow(size_t min_size) {
-    size_t size = std::max(min_size, default_chunk_size);
+    // Each chunk doubles the last, so a big tree takes O(log n) mallocs.
+    size_t size = default_chunk_size;
+    if (!chunks.empty()) size = std::max(size, std::min(chunks.back().size * 2, MAX_CHUNK_SIZE));
+    size = std::max(size, min_size);
     uint8_t* data = static_cast<uint8_t*>(malloc(size));
+    if (data == nullptr) throw std::bad_alloc();
     chunks.push_back({data, size, 0});
 }
 
-} // namespace xerith
\ No newline at end of file
+void Arena::add_finalizer(void* object, void (*destroy)(void*)) {
+    // The bookkeeping lives in the arena too, so it costs no extra malloc.
+    Finalizer* finalizer = static_cast<Finalizer*>(alloc(sizeof(Finalizer)));
+    *finalizer = {destroy, object, finalizers};
+    finalizers = finalizer;
+}
+
+void Arena::run_finalizers(Finalizer* until) {
+    // Newest first, mirroring normal destruction order.
+    for (Finalizer* f = finalizers; f != until; f = f->next) {
+        f->destroy(f->object);
+    }
+    finalizers = until;
+}
+
+} // namespace xerith
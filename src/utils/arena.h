@@ -4,11 +4,39 @@
 #include <vector>
 #include <cstddef>
 #include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace xerith {
 
+// What an allocator has handed out and what it holds from the system.
+struct ArenaStats {
+    size_t allocations = 0;     // successful alloc() calls since construction
+    size_t bytes_used = 0;      // handed out and not yet reset or rewound
+    size_t bytes_reserved = 0;  // held in chunks
+    size_t chunks = 0;
+};
+
+/**
+ * @brief Bump allocator for objects that die together.
+ * Chunks start at `chunk_size` and double up to MAX_CHUNK_SIZE, so a
+ * large tree needs few mallocs without a small one reserving much.
+ * Memory comes back all at once, through reset() or rewind().
+ */
 class Arena {
+    struct Finalizer;
+
 public:
+    static constexpr size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+    // A point to rewind() to; taken by mark().
+    struct Mark {
+        size_t chunk_count = 0;
+        size_t used = 0;
+        Finalizer* finalizers = nullptr;
+    };
+
     // Default chunk size is 4KB
     explicit Arena(size_t chunk_size = 4096);
     ~Arena();
@@ -17,16 +45,44 @@ public:
     Arena(const Arena&) = delete;
     Arena& operator=(const Arena&) = delete;
 
-    // The main function: Grab some memory
+    // The main function: Grab some memory, 8-byte aligned.
     void* alloc(size_t size);
+    // `align` must be a power of two.
+    void* alloc(size_t size, size_t align);
 
-    // Template helper to make allocating objects easier
+    // Template helper to make allocating objects easier.
+    // Objects that need a destructor are remembered and destroyed by reset().
     template <typename T, typename... Args>
     T* construct(Args&&... args) {
-        void* mem = alloc(sizeof(T));
-        return new (mem) T(std::forward<Args>(args)...);
+        void* mem = alignof(T) <= 8 ? alloc(sizeof(T)) : alloc(sizeof(T), alignof(T));
+        T* object = new (mem) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            add_finalizer(object, [](void* ptr) { static_cast<T*>(ptr)->~T(); });
+        }
+        return object;
+    }
+
+    // Uninitialised storage for `count` objects of a trivially destructible type.
+    template <typename T>
+    T* alloc_array(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena arrays are never destroyed");
+        return static_cast<T*>(alignof(T) <= 8 ? alloc(sizeof(T) * count) : alloc(sizeof(T) * count, alignof(T)));
     }
 
+    // Destroys everything constructed so far and makes the memory reusable.
+    // The first chunk is kept so a reused arena does not hit malloc again.
+    void reset();
+
+    // Checkpoints for scratch work: rewind(mark()) destroys what was
+    // constructed since the mark, newest first, and frees the chunks
+    // added since. Marks must be rewound in reverse order of taking.
+    Mark mark() const;
+    void rewind(const Mark& mark);
+
+    // Bytes handed out since construction or the last reset.
+    size_t bytes_used() const;
+    ArenaStats stats() const;
+
 private:
     struct Chunk {
         uint8_t* data;
@@ -34,12 +90,95 @@ private:
         size_t used;
     };
 
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
     void grow(size_t min_size);
+    void add_finalizer(void* object, void (*destroy)(void*));
+    // Runs the finalizers newer than `until`.
+    void run_finalizers(Finalizer* until = nullptr);
 
     size_t default_chunk_size;
     std::vector<Chunk> chunks;
+    Finalizer* finalizers = nullptr;
+    size_t allocation_count = 0;
+};
+
+// What a Pool has handed out and taken back.
+struct PoolStats {
+    size_t allocations = 0;
+    size_t reused = 0;      // allocations served from a free list
+    size_t frees = 0;
+    size_t live_bytes = 0;  // in blocks allocated and not yet freed
+};
+
+/**
+ * @brief Size-class free lists over an Arena, for objects that die one
+ * at a time.
+ * Sizes round up to 16 bytes, and every 16-byte class up to MAX_BLOCK
+ * keeps its own list of freed blocks; a freed block is reused by the
+ * next allocation of its class, and the arena is only bumped when the
+ * list is empty. Larger blocks go to the system allocator. Memory never
+ * moves between classes and only goes back to the system with the pool.
+ */
+class Pool {
+public:
+    static constexpr size_t GRANULE = 16;
+    static constexpr size_t MAX_BLOCK = 256;
+
+    explicit Pool(size_t chunk_size = 64 * 1024) : arena(chunk_size) {}
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    // The size a request for `size` bytes really takes; even an empty
+    // request gets a block of the smallest class.
+    static constexpr size_t block_size(size_t size) {
+        return size == 0 ? GRANULE : (size + GRANULE - 1) & ~(GRANULE - 1);
+    }
+
+    void* allocate(size_t size) {
+        size = block_size(size);
+        counts.allocations++;
+        counts.live_bytes += size;
+        if (size > MAX_BLOCK) return ::operator new(size);
+        FreeBlock*& free_list = free_lists[size / GRANULE - 1];
+        if (free_list == nullptr) return arena.alloc(size, GRANULE);
+        FreeBlock* block = free_list;
+        free_list = block->next;
+        counts.reused++;
+        return block;
+    }
+
+    // `size` must be what the block was allocated with.
+    void deallocate(void* block, size_t size) {
+        size = block_size(size);
+        counts.frees++;
+        counts.live_bytes -= size;
+        if (size > MAX_BLOCK) {
+            ::operator delete(block);
+            return;
+        }
+        FreeBlock*& free_list = free_lists[size / GRANULE - 1];
+        free_list = new (block) FreeBlock{free_list};
+    }
+
+    const PoolStats& stats() const { return counts; }
+    ArenaStats arena_stats() const { return arena.stats(); }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    Arena arena;
+    FreeBlock* free_lists[MAX_BLOCK / GRANULE] = {};
+    PoolStats counts;
 };
 
 } // namespace xerith
 
-#endif // XERITH_ARENA_H
\ No newline at end of file
+#endif // XERITH_ARENA_H
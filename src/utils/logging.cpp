@@ -1,5 +1,6 @@
 #include "logging.h"
 #include <iostream>
+#include "stats.h"
 
 namespace xerith {
 
@@ -30,4 +31,8 @@ void Logger::log(LogLevel level, const std::string& message) {
     std::cout << color << prefix << " " << message << "\033[0m" << std::endl;
 }
 
+void Logger::stats(bool json) {
+    Stats::report(std::cerr, json);
+}
+
 } // namespace xerith
\ No newline at end of file
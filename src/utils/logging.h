@@ -21,6 +21,10 @@ public:
     static void debug(const std::string& msg) { log(LogLevel::DEBUG, msg); }
     static void warn(const std::string& msg) { log(LogLevel::WARNING, msg); }
     static void error(const std::string& msg) { log(LogLevel::ERROR, msg); }
+
+    // Phase times and counters gathered under --stats (see stats.h),
+    // written to stderr as an aligned table or a single JSON object.
+    static void stats(bool json);
 };
 
 } // namespace xerith
@@ -0,0 +1,114 @@
+#include "source_manager.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace xerith {
+
+SourceManager::File::~File() {
+    if (mapping != nullptr) munmap(mapping, mapped_size);
+}
+
+std::deque<SourceManager::File>& SourceManager::files() {
+    static std::deque<File> table = [] {
+        // Slot 0 stands in for spans that do not point into any file.
+        std::deque<File> initial;
+        initial.emplace_back("unknown");
+        return initial;
+    }();
+    return table;
+}
+
+FileId SourceManager::add(std::string name, std::string text) {
+    auto& table = files();
+    File& entry = table.emplace_back(std::move(name));
+    entry.owned = std::move(text);
+    entry.text = entry.owned;
+    return static_cast<FileId>(table.size() - 1);
+}
+
+FileId SourceManager::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return 0;
+    }
+
+    auto& table = files();
+    File& entry = table.emplace_back(path);
+    size_t size = static_cast<size_t>(info.st_size);
+    // mmap rejects zero-length mappings; an empty file is just empty text.
+    if (size > 0) {
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            table.pop_back();
+            return 0;
+        }
+        // The lexer walks the text front to back exactly once.
+        madvise(data, size, MADV_SEQUENTIAL);
+        entry.mapping = data;
+        entry.mapped_size = size;
+        entry.text = std::string_view(static_cast<const char*>(data), size);
+    }
+    close(fd);
+    return static_cast<FileId>(table.size() - 1);
+}
+
+SourceManager::File& SourceManager::get(FileId file) {
+    auto& table = files();
+    return file < table.size() ? table[file] : table[0];
+}
+
+std::string_view SourceManager::text(FileId file) {
+    return get(file).text;
+}
+
+const std::string& SourceManager::name(FileId file) {
+    return get(file).name;
+}
+
+const std::vector<uint32_t>& SourceManager::line_starts(File& file) {
+    if (file.line_starts.empty()) {
+        file.line_starts.push_back(0);
+        for (size_t i = 0; i < file.text.size(); i++) {
+            if (file.text[i] == '\n') file.line_starts.push_back(static_cast<uint32_t>(i + 1));
+        }
+    }
+    return file.line_starts;
+}
+
+LineColumn SourceManager::resolve(const Span& span) {
+    if (!span.is_valid()) return {0, 0};
+    const auto& starts = line_starts(get(span.file));
+    // The line is the last start at or before the offset.
+    auto it = std::upper_bound(starts.begin(), starts.end(), span.offset);
+    int line = static_cast<int>(it - starts.begin());
+    int column = static_cast<int>(span.offset - starts[line - 1]) + 1;
+    return {line, column};
+}
+
+std::string_view SourceManager::line_text(FileId file, int line) {
+    File& entry = get(file);
+    const auto& starts = line_starts(entry);
+    if (line < 1 || line > static_cast<int>(starts.size())) return {};
+
+    std::string_view text = entry.text;
+    size_t begin = starts[line - 1];
+    size_t end = text.find('\n', begin);
+    if (end == std::string_view::npos) end = text.size();
+    if (end > begin && text[end - 1] == '\r') end--;
+    return text.substr(begin, end - begin);
+}
+
+void Span::print(std::ostream& os) const {
+    LineColumn position = SourceManager::resolve(*this);
+    os << SourceManager::name(file) << ":" << position.line << ":" << position.column;
+}
+
+} // namespace xerith
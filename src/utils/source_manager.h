@@ -0,0 +1,62 @@
+#ifndef XERITH_SOURCE_MANAGER_H
+#define XERITH_SOURCE_MANAGER_H
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "span.h"
+
+namespace xerith {
+
+struct LineColumn {
+    int line;
+    int column;
+};
+
+/**
+ * @brief Owns the text of every loaded source file.
+ * Tokens and AST nodes hold views into these buffers, so a file stays
+ * registered for the lifetime of the process. The table of line starts
+ * is only built the first time a location in that file is resolved.
+ * Files read from disk are memory-mapped rather than copied.
+ */
+class SourceManager {
+public:
+    static FileId add(std::string name, std::string text);
+
+    // Maps the file at `path` read-only. Returns 0 if it cannot be opened.
+    static FileId load(const std::string& path);
+
+    static std::string_view text(FileId file);
+    static const std::string& name(FileId file);
+
+    // 1-based line and column of `span`; {0, 0} for an invalid span.
+    static LineColumn resolve(const Span& span);
+
+    // Text of a 1-based line without its newline.
+    static std::string_view line_text(FileId file, int line);
+
+private:
+    struct File {
+        std::string name;
+        std::string_view text;              // into `owned` or the mapping
+        std::string owned;
+        void* mapping = nullptr;
+        size_t mapped_size = 0;
+        std::vector<uint32_t> line_starts;  // empty until first needed
+
+        explicit File(std::string name) : name(std::move(name)) {}
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+        ~File();
+    };
+
+    static File& get(FileId file);
+    static const std::vector<uint32_t>& line_starts(File& file);
+    static std::deque<File>& files();
+};
+
+} // namespace xerith
+
+#endif // XERITH_SOURCE_MANAGER_H
@@ -1,33 +1,35 @@
 #ifndef XERITH_SPAN_H
 #define XERITH_SPAN_H
 
-#include <string>
+#include <cstdint>
 #include <iostream>
 
 namespace xerith {
 
+// Handle for a file registered with the SourceManager; 0 means "unknown".
+using FileId = uint32_t;
+
 /**
  * @brief Represents a location within a source file.
- * Essential for providing "Easy Job" diagnostics to the user.
+ * Only a file handle and a byte offset are stored, so spans are cheap to
+ * copy; line and column are worked out by the SourceManager when a
+ * diagnostic actually needs them.
  */
 struct Span {
-    std::string filename;
-    int line;
-    int column;
+    FileId file;
+    uint32_t offset;
 
     // default constructor for empty spans
-    Span() : filename("unknown"), line(0), column(0) {}
+    Span() : file(0), offset(0) {}
+
+    Span(FileId file, uint32_t offset) : file(file), offset(offset) {}
 
-    // detailed constructor
-    Span(std::string file, int ln, int col) 
-        : filename(std::move(file)), line(ln), column(col) {}
+    bool is_valid() const { return file != 0; }
 
     // Helper to print the span in a standard format: "file:line:col"
-    void print(std::ostream& os) const {
-        os << filename << ":" << line << ":" << column;
-    }
+    void print(std::ostream& os) const;
 };
 
-} 
+} // namespace xerith
 
-#endif 
\ No newline at end of file
+#endif
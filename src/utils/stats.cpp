@@ -0,0 +1,68 @@
+#include "stats.h"
+#include <cstdio>
+
+namespace xerith {
+
+namespace {
+
+const char* const PHASE_NAMES[] = {"lex", "parse", "fold", "resolve", "compile", "execute", "gc"};
+const char* const COUNTER_NAMES[] = {"tokens", "ast_nodes", "environments", "allocations", "opcodes", "calls",
+                                     "heap_bytes", "gc_runs", "gc_freed"};
+
+} // namespace
+
+StatPhase Stats::switch_to(StatPhase phase) {
+    auto now = std::chrono::steady_clock::now();
+    if (running != StatPhase::NONE) {
+        seconds[static_cast<int>(running)] += std::chrono::duration<double>(now - last_switch).count();
+    }
+    last_switch = now;
+    StatPhase previous = running;
+    running = phase;
+    return previous;
+}
+
+void Stats::merge_thread() {
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        total_counters[i] += counters[i];
+        counters[i] = 0;
+    }
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        total_seconds[i] += seconds[i];
+        seconds[i] = 0;
+    }
+}
+
+void Stats::report(std::ostream& os, bool json) {
+    merge_thread();
+    const double* seconds = total_seconds;
+    const uint64_t* counters = total_counters;
+    char row[96];
+    if (json) {
+        os << "{\"phases\": {";
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            std::snprintf(row, sizeof(row), "%s\"%s\": %.6f", i ? ", " : "", PHASE_NAMES[i], seconds[i]);
+            os << row;
+        }
+        os << "}, \"counters\": {";
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            os << (i ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << counters[i];
+        }
+        os << "}}\n";
+        return;
+    }
+
+    os << "== stats ==\n";
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        std::snprintf(row, sizeof(row), "%-14s %12.6f s\n", PHASE_NAMES[i], seconds[i]);
+        os << row;
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        std::snprintf(row, sizeof(row), "%-14s %12llu\n", COUNTER_NAMES[i],
+                      static_cast<unsigned long long>(counters[i]));
+        os << row;
+    }
+}
+
+} // namespace xerith
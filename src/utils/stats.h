@@ -0,0 +1,111 @@
+#ifndef XERITH_STATS_H
+#define XERITH_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+
+// Set to 0 (cmake -DXERITH_ENABLE_STATS=OFF) to compile every
+// XERITH_STATS_* site down to nothing.
+#ifndef XERITH_ENABLE_STATS
+#define XERITH_ENABLE_STATS 1
+#endif
+
+namespace xerith {
+
+enum class StatPhase : uint8_t {
+    LEX, PARSE, FOLD, RESOLVE, COMPILE, EXECUTE,
+    GC,   // collections, taken out of the phase that triggered them
+    NONE  // time outside every phase; not reported
+};
+
+enum class StatCounter : uint8_t {
+    TOKENS, AST_NODES, ENVIRONMENTS, ALLOCATIONS, OPCODES, CALLS,
+    HEAP_BYTES,  // bytes of functions, closures and upvalues allocated
+    GC_RUNS, GC_FREED,
+    COUNT
+};
+
+/**
+ * @brief Process-wide counters and phase times behind `--stats`.
+ * Phases nest: entering one pauses the phase it interrupts, so each is
+ * charged only its own time (the parser pulls tokens, so "parse" excludes
+ * the lexing it drives). Counters are bumped unconditionally, which is a
+ * single add; the VM only counts opcodes while enabled, and phase timers
+ * read the clock only while enabled. Counts and times are kept per thread
+ * so loader threads never share a cache line; merge_thread() folds a
+ * thread's share into the totals that report() prints.
+ */
+class Stats {
+public:
+    static bool enabled() { return on; }
+    static void enable() { on = true; }
+
+    static void add(StatCounter counter, uint64_t n) { counters[static_cast<int>(counter)] += n; }
+
+    // Charges the time since the last switch to the running phase, then
+    // makes `phase` the running one. Returns the phase it replaced.
+    static StatPhase switch_to(StatPhase phase);
+
+    // Adds this thread's counts and times to the totals and zeroes them.
+    // Worker threads call it before they finish.
+    static void merge_thread();
+
+    // Merges the calling thread, then prints the totals.
+    static void report(std::ostream& os, bool json);
+
+private:
+    static constexpr int PHASE_COUNT = static_cast<int>(StatPhase::NONE);
+    static constexpr int COUNTER_COUNT = static_cast<int>(StatCounter::COUNT);
+
+    inline static bool on = false;
+    inline static thread_local uint64_t counters[COUNTER_COUNT] = {};
+    inline static thread_local double seconds[PHASE_COUNT] = {};
+    inline static thread_local StatPhase running = StatPhase::NONE;
+    inline static thread_local std::chrono::steady_clock::time_point last_switch;
+
+    inline static std::mutex totals_mutex;
+    inline static uint64_t total_counters[COUNTER_COUNT] = {};
+    inline static double total_seconds[PHASE_COUNT] = {};
+};
+
+/**
+ * @brief Charges its scope to a phase; a no-op unless stats are enabled.
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(StatPhase phase) {
+        if (Stats::enabled()) {
+            outer = Stats::switch_to(phase);
+            active = true;
+        }
+    }
+
+    ~PhaseTimer() {
+        if (active) Stats::switch_to(outer);
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    StatPhase outer = StatPhase::NONE;
+    bool active = false;
+};
+
+} // namespace xerith
+
+#define XERITH_STATS_CONCAT_(a, b) a##b
+#define XERITH_STATS_CONCAT(a, b) XERITH_STATS_CONCAT_(a, b)
+
+#if XERITH_ENABLE_STATS
+#define XERITH_STATS_COUNT(counter, n) ::xerith::Stats::add(::xerith::StatCounter::counter, (n))
+#define XERITH_STATS_PHASE(phase) \
+    ::xerith::PhaseTimer XERITH_STATS_CONCAT(xerith_phase_, __LINE__)(::xerith::StatPhase::phase)
+#else
+#define XERITH_STATS_COUNT(counter, n) ((void)0)
+#define XERITH_STATS_PHASE(phase) ((void)0)
+#endif
+
+#endif // XERITH_STATS_H
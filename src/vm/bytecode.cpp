@@ -1 +1,60 @@
-// Will be written soon
+#include "bytecode.h"
+#include "../runtime/heap.h"
+
+namespace xerith {
+
+const char* opcode_name(OpCode op) {
+    switch (op) {
+#define XERITH_OPCODE_NAME(name, operand, effect) case OpCode::name: return #name;
+        XERITH_OPCODES(XERITH_OPCODE_NAME)
+#undef XERITH_OPCODE_NAME
+    }
+    return "UNKNOWN";
+}
+
+void CompiledFunction::trace(Tracer& tracer) const {
+    // Nested functions are constants of the body.
+    for (const Value& constant : chunk.constants) tracer.mark(constant);
+}
+
+size_t CompiledFunction::owned_bytes() const {
+    return chunk.code.capacity() + chunk.spans.capacity() * sizeof(Span) +
+           chunk.constants.capacity() * sizeof(Value) + chunk.global_caches.capacity() * sizeof(GlobalCache) +
+           captures.capacity() * sizeof(Capture);
+}
+
+void Closure::trace(Tracer& tracer) const {
+    tracer.mark(prototype);
+    for (const Value& upvalue : upvalues) tracer.mark(upvalue);
+}
+
+OperandKind opcode_operand(OpCode op) {
+    switch (op) {
+#define XERITH_OPCODE_OPERAND(name, operand, effect) case OpCode::name: return OperandKind::operand;
+        XERITH_OPCODES(XERITH_OPCODE_OPERAND)
+#undef XERITH_OPCODE_OPERAND
+    }
+    return OperandKind::NONE;
+}
+
+int opcode_stack_effect(OpCode op) {
+    switch (op) {
+#define XERITH_OPCODE_EFFECT(name, operand, effect) case OpCode::name: return effect;
+        XERITH_OPCODES(XERITH_OPCODE_EFFECT)
+#undef XERITH_OPCODE_EFFECT
+    }
+    return 0;
+}
+
+void Chunk::write(uint8_t byte, Span span) {
+    code.push_back(byte);
+    spans.push_back(span);
+}
+
+size_t Chunk::add_constant(Value value) {
+    constants.push_back(std::move(value));
+    global_caches.emplace_back();
+    return constants.size() - 1;
+}
+
+} // namespace xerith
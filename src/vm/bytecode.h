@@ -1 +1,142 @@
-// Will be written soon
+#ifndef XERITH_BYTECODE_H
+#define XERITH_BYTECODE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../runtime/value.h"
+#include "../sema/symbols.h"
+#include "../utils/span.h"
+
+namespace xerith {
+
+/**
+ * @brief Kind of inline operand that follows an opcode.
+ * All operands are 16-bit big-endian.
+ */
+enum class OperandKind : uint8_t {
+    NONE,      // no operand
+    CONSTANT,  // index into Chunk::constants
+    SLOT,      // local slot relative to the frame base
+    UPVALUE,   // index into the running closure's upvalues
+    JUMP,      // forward offset from the end of the instruction
+    LOOP,      // backward offset from the end of the instruction
+    COUNT      // number of arguments
+};
+
+// X(name, operand kind, stack effect). The calls also pop their
+// arguments, which the compiler accounts for separately.
+#define XERITH_OPCODES(X)                 \
+    X(CONSTANT,      CONSTANT,  1)        \
+    X(NIL,           NONE,      1)        \
+    X(TRUE,          NONE,      1)        \
+    X(FALSE,         NONE,      1)        \
+    X(POP,           NONE,     -1)        \
+    X(GET_LOCAL,     SLOT,      1)        \
+    X(SET_LOCAL,     SLOT,      0)        \
+    X(BOX,           SLOT,      0)        \
+    X(GET_BOXED,     SLOT,      1)        \
+    X(SET_BOXED,     SLOT,      0)        \
+    X(GET_UPVALUE,   UPVALUE,   1)        \
+    X(SET_UPVALUE,   UPVALUE,   0)        \
+    X(GET_GLOBAL,    CONSTANT,  1)        \
+    X(DEFINE_GLOBAL, CONSTANT, -1)        \
+    X(SET_GLOBAL,    CONSTANT,  0)        \
+    X(EQUAL,         NONE,     -1)        \
+    X(NOT_EQUAL,     NONE,     -1)        \
+    X(GREATER,       NONE,     -1)        \
+    X(GREATER_EQUAL, NONE,     -1)        \
+    X(LESS,          NONE,     -1)        \
+    X(LESS_EQUAL,    NONE,     -1)        \
+    X(ADD,           NONE,     -1)        \
+    X(SUBTRACT,      NONE,     -1)        \
+    X(MULTIPLY,      NONE,     -1)        \
+    X(DIVIDE,        NONE,     -1)        \
+    X(NOT,           NONE,      0)        \
+    X(NEGATE,        NONE,      0)        \
+    X(PRINT,         NONE,     -1)        \
+    X(JUMP,          JUMP,      0)        \
+    X(JUMP_IF_FALSE, JUMP,     -1)        \
+    X(LOOP,          LOOP,      0)        \
+    X(CLOSURE,       CONSTANT,  1)        \
+    X(CALL,          COUNT,     0)        \
+    X(TAIL_CALL,     COUNT,     0)        \
+    X(RETURN,        NONE,      0)
+
+enum class OpCode : uint8_t {
+#define XERITH_OPCODE_ENUM(name, operand, effect) name,
+    XERITH_OPCODES(XERITH_OPCODE_ENUM)
+#undef XERITH_OPCODE_ENUM
+};
+
+const char* opcode_name(OpCode op);
+OperandKind opcode_operand(OpCode op);
+int opcode_stack_effect(OpCode op);
+
+/**
+ * @brief The VM's inline cache for one global name constant.
+ * It is current while `version` equals the running VM's globals version,
+ * which is unique to that VM and changes whenever its cells move.
+ */
+struct GlobalCache {
+    Value* cell = nullptr;
+    uint32_t version = 0;
+};
+
+/**
+ * @brief A compiled unit of bytecode with its constant pool.
+ * `spans` runs parallel to `code` so the VM and disassembler can map any
+ * byte back to its source location.
+ */
+struct Chunk {
+    std::vector<uint8_t> code;
+    std::vector<Span> spans;
+    std::vector<Value> constants;
+    // Parallel to `constants`; only the VM reads or writes them.
+    mutable std::vector<GlobalCache> global_caches;
+
+    // Deepest operand stack the chunk needs, computed by the compiler.
+    // For a function this counts from its first argument.
+    size_t max_stack = 0;
+
+    void write(uint8_t byte, Span span);
+    size_t add_constant(Value value);
+};
+
+/**
+ * @brief A function body compiled to its own chunk; a constant of the
+ * chunk that declares it.
+ * A function that captures nothing is called as it is. One that does
+ * is only a prototype: CLOSURE wraps it in a Closure along with the
+ * boxes `captures` names in the declaring frame.
+ */
+struct CompiledFunction : ObjFunction {
+    Chunk chunk;
+    std::vector<Capture> captures;
+
+    CompiledFunction(ObjString* name, int arity) : ObjFunction(FunctionKind::COMPILED, name, arity) {}
+
+    void trace(Tracer& tracer) const override;
+    size_t owned_bytes() const override;
+};
+
+/**
+ * @brief A CompiledFunction together with the upvalues it captured.
+ */
+struct Closure : ObjFunction {
+    Value prototype;              // the CompiledFunction
+    std::vector<Value> upvalues;  // ObjUpvalue boxes, in `captures` order
+
+    explicit Closure(Value prototype)
+        : ObjFunction(FunctionKind::CLOSURE, prototype.as_function()->name, prototype.as_function()->arity),
+          prototype(std::move(prototype)) {}
+
+    const CompiledFunction* function() const { return static_cast<const CompiledFunction*>(prototype.as_function()); }
+
+    void trace(Tracer& tracer) const override;
+    size_t owned_bytes() const override { return upvalues.capacity() * sizeof(Value); }
+};
+
+} // namespace xerith
+
+#endif // XERITH_BYTECODE_H
@@ -0,0 +1,324 @@
+#include "chunk_cache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../runtime/heap.h"
+#include "../utils/source_manager.h"
+
+namespace xerith {
+
+namespace {
+
+constexpr char MAGIC[4] = {'X', 'B', 'C', '\0'};
+constexpr uint32_t OPCODE_COUNT = static_cast<uint32_t>(OpCode::RETURN) + 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t opcode_count;
+    uint64_t payload_hash;  // of everything after the Header
+};
+
+// Precedes every chunk: the script's right after the Header, and each
+// function's inside the constant that holds it.
+struct ChunkHeader {
+    uint32_t code_size;
+    uint32_t constant_count;
+    uint32_t max_stack;
+};
+
+// Bounds-checked cursor over the mapped file.
+struct Reader {
+    const uint8_t* data;
+    const uint8_t* end;
+    bool ok = true;
+
+    bool read(void* out, size_t size) {
+        if (!ok || static_cast<size_t>(end - data) < size) return ok = false;
+        std::memcpy(out, data, size);
+        data += size;
+        return true;
+    }
+
+    template <typename T>
+    T read() {
+        T value{};
+        read(&value, sizeof(T));
+        return value;
+    }
+
+    uint64_t read_varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = read<uint8_t>();
+            if (!ok) return 0;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+template <typename T>
+void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void append_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// Identifiers and string literals come back pinned, like the lexer's:
+// the VM keys globals on them.
+ObjString* read_string(Reader& reader) {
+    uint32_t length = reader.read<uint32_t>();
+    if (!reader.ok || static_cast<size_t>(reader.end - reader.data) < length) {
+        reader.ok = false;
+        return nullptr;
+    }
+    std::string_view text(reinterpret_cast<const char*>(reader.data), length);
+    reader.data += length;
+    return intern_pinned(text);
+}
+
+// Walks the decoded code and rejects anything the VM would take on trust:
+// an unknown opcode, an operand past the end, or one naming a constant,
+// slot, upvalue or instruction that is not there. `arity` and
+// `upvalue_count` are those of the chunk's function; the script's are zero.
+bool verify_code(const Chunk& chunk, size_t arity, size_t upvalue_count) {
+    const std::vector<uint8_t>& code = chunk.code;
+    // Past the arguments, every value on the stack was pushed by a byte of
+    // code, so no more can be live at once; the VM reserves max_stack.
+    if (chunk.max_stack < arity || chunk.max_stack > arity + code.size()) return false;
+    std::vector<bool> starts(code.size() + 1, false);
+    std::vector<size_t> targets;
+    OpCode op = OpCode::RETURN;
+    for (size_t at = 0; at < code.size();) {
+        starts[at] = true;
+        if (code[at] >= OPCODE_COUNT) return false;
+        op = static_cast<OpCode>(code[at]);
+        OperandKind kind = opcode_operand(op);
+        size_t end = at + (kind == OperandKind::NONE ? 1 : 3);
+        if (end > code.size()) return false;
+        size_t operand = kind == OperandKind::NONE ? 0 : static_cast<size_t>((code[at + 1] << 8) | code[at + 2]);
+        switch (kind) {
+            case OperandKind::NONE: break;
+            case OperandKind::CONSTANT: {
+                if (operand >= chunk.constants.size()) return false;
+                ValueType type = chunk.constants[operand].get_type();
+                if (op == OpCode::CLOSURE && type != ValueType::FUNCTION) return false;
+                if (op != OpCode::CONSTANT && op != OpCode::CLOSURE && type != ValueType::STRING) return false;
+                break;
+            }
+            case OperandKind::SLOT:
+                if (operand >= chunk.max_stack) return false;
+                break;
+            case OperandKind::UPVALUE:
+                if (operand >= upvalue_count) return false;
+                break;
+            case OperandKind::JUMP: targets.push_back(end + operand); break;
+            case OperandKind::LOOP:
+                if (operand > end) return false;
+                targets.push_back(end - operand);
+                break;
+            case OperandKind::COUNT:
+                if (operand >= chunk.max_stack) return false;  // the callee sits below its arguments
+                break;
+        }
+        at = end;
+    }
+    // Every path ends in a RETURN, so the last instruction must be one.
+    if (code.empty() || op != OpCode::RETURN) return false;
+    for (size_t target : targets) {
+        if (target >= code.size() || !starts[target]) return false;
+    }
+    return true;
+}
+
+bool decode_chunk(Reader& reader, FileId file, Chunk& chunk, size_t arity, size_t upvalue_count) {
+    ChunkHeader header = reader.read<ChunkHeader>();
+    if (!reader.ok || static_cast<size_t>(reader.end - reader.data) < header.code_size) return false;
+
+    chunk.code.resize(header.code_size);
+    reader.read(chunk.code.data(), header.code_size);
+    chunk.spans.reserve(header.code_size);
+    int64_t offset = 0;
+    for (uint32_t i = 0; i < header.code_size && reader.ok; i++) {
+        uint64_t zigzag = reader.read_varint();
+        offset += static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        chunk.spans.emplace_back(file, static_cast<uint32_t>(offset));
+    }
+
+    for (uint32_t i = 0; i < header.constant_count && reader.ok; i++) {
+        switch (static_cast<ValueType>(reader.read<uint8_t>())) {
+            case ValueType::NIL:    chunk.add_constant(Value()); break;
+            case ValueType::BOOL:   chunk.add_constant(Value(reader.read<uint8_t>() != 0)); break;
+            case ValueType::NUMBER: chunk.add_constant(Value(reader.read<double>())); break;
+            case ValueType::STRING: {
+                ObjString* text = read_string(reader);
+                if (text == nullptr) return false;
+                chunk.add_constant(Value(text));
+                break;
+            }
+            case ValueType::FUNCTION: {
+                ObjString* name = read_string(reader);
+                int32_t arity = reader.read<int32_t>();
+                uint32_t capture_count = reader.read<uint32_t>();
+                if (name == nullptr || !reader.ok || arity < 0) return false;
+                auto* function = Heap::make<CompiledFunction>(name, arity);
+                Value value(function);
+                for (uint32_t c = 0; c < capture_count && reader.ok; c++) {
+                    int32_t index = reader.read<int32_t>();
+                    bool local = reader.read<uint8_t>() != 0;
+                    // A capture takes a slot of the declaring frame or one
+                    // of its own upvalues.
+                    size_t limit = local ? header.max_stack : upvalue_count;
+                    if (index < 0 || static_cast<size_t>(index) >= limit) return false;
+                    function->captures.push_back({index, local});
+                }
+                if (!reader.ok || !decode_chunk(reader, file, function->chunk, arity, capture_count)) return false;
+                Heap::account(function);
+                chunk.add_constant(std::move(value));
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    chunk.max_stack = header.max_stack;
+    return reader.ok && verify_code(chunk, arity, upvalue_count);
+}
+
+bool decode(Reader& reader, uint64_t source_hash, FileId file, Chunk& chunk) {
+    Header header = reader.read<Header>();
+    if (!reader.ok || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+    if (header.version != CHUNK_CACHE_VERSION || header.opcode_count != OPCODE_COUNT) return false;
+    if (header.source_hash != source_hash) return false;
+    // A file damaged in a way the walk cannot see, like a lowered
+    // max_stack, still fails the hash.
+    std::string_view payload(reinterpret_cast<const char*>(reader.data), static_cast<size_t>(reader.end - reader.data));
+    if (header.payload_hash != hash_source(payload)) return false;
+    return decode_chunk(reader, file, chunk, 0, 0) && reader.data == reader.end;
+}
+
+void append_string(std::string& out, const std::string& text) {
+    append(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+void encode_chunk(std::string& out, const Chunk& chunk) {
+    ChunkHeader header{};
+    header.code_size = static_cast<uint32_t>(chunk.code.size());
+    header.constant_count = static_cast<uint32_t>(chunk.constants.size());
+    header.max_stack = static_cast<uint32_t>(chunk.max_stack);
+    append(out, header);
+
+    out.append(reinterpret_cast<const char*>(chunk.code.data()), chunk.code.size());
+    // Spans are zigzag-encoded deltas: neighbouring bytes almost always
+    // share a source location or sit close together, so most take a byte.
+    int64_t previous = 0;
+    for (const Span& span : chunk.spans) {
+        int64_t delta = static_cast<int64_t>(span.offset) - previous;
+        append_varint(out, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+        previous = span.offset;
+    }
+    for (const Value& constant : chunk.constants) {
+        append(out, static_cast<uint8_t>(constant.get_type()));
+        switch (constant.get_type()) {
+            case ValueType::NIL:    break;
+            case ValueType::BOOL:   append(out, static_cast<uint8_t>(constant.as_bool())); break;
+            case ValueType::NUMBER: append(out, constant.as_number()); break;
+            case ValueType::STRING: append_string(out, constant.as_string()); break;
+            case ValueType::FUNCTION: {
+                const auto* function = static_cast<const CompiledFunction*>(constant.as_function());
+                append_string(out, function->name->chars);
+                append(out, static_cast<int32_t>(function->arity));
+                append(out, static_cast<uint32_t>(function->captures.size()));
+                for (const Capture& capture : function->captures) {
+                    append(out, static_cast<int32_t>(capture.index));
+                    append(out, static_cast<uint8_t>(capture.local));
+                }
+                encode_chunk(out, function->chunk);
+                break;
+            }
+            case ValueType::UPVALUE: break;  // never a constant
+        }
+    }
+}
+
+} // namespace
+
+uint64_t hash_source(std::string_view text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string cache_path(const std::string& script) {
+    const char* dir = std::getenv("XERITH_CACHE_DIR");
+    if (dir == nullptr || *dir == '\0') return script + ".xbc";
+    size_t slash = script.rfind('/');
+    std::string base = slash == std::string::npos ? script : script.substr(slash + 1);
+    return std::string(dir) + "/" + base + ".xbc";
+}
+
+bool load_cached_chunk(const std::string& path, FileId file, Chunk& chunk) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Header))) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    Reader reader{static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size};
+    Chunk loaded;
+    bool ok = decode(reader, hash_source(SourceManager::text(file)), file, loaded);
+    munmap(data, size);
+    if (ok) chunk = std::move(loaded);
+    return ok;
+}
+
+bool save_cached_chunk(const std::string& path, FileId file, const Chunk& chunk) {
+    std::string out;
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = CHUNK_CACHE_VERSION;
+    header.source_hash = hash_source(SourceManager::text(file));
+    header.opcode_count = OPCODE_COUNT;
+    append(out, header);
+    encode_chunk(out, chunk);
+    header.payload_hash = hash_source(std::string_view(out).substr(sizeof(Header)));
+    std::memcpy(&out[0], &header, sizeof(Header));
+
+    // Write beside the target and rename, so a reader never sees half a file.
+    std::string temp = path + ".tmp";
+    FILE* handle = std::fopen(temp.c_str(), "wb");
+    if (handle == nullptr) return false;
+    bool written = std::fwrite(out.data(), 1, out.size(), handle) == out.size();
+    written = std::fclose(handle) == 0 && written;
+    if (!written || std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace xerith
@@ -0,0 +1,42 @@
+#ifndef XERITH_CHUNK_CACHE_H
+#define XERITH_CHUNK_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "bytecode.h"
+
+namespace xerith {
+
+/**
+ * @brief On-disk cache of compiled chunks, so an unchanged script can skip
+ * lexing, parsing, resolution and compilation.
+ * A cache file is only trusted if its format version, opcode count,
+ * 64-bit hashes of the source text and of the payload all match, and its
+ * code only names constants, slots and jump targets that exist; anything
+ * else is treated as a miss and overwritten. That catches a damaged or
+ * truncated file, not one crafted to pass: the VM still trusts the stack
+ * discipline and value types of the code it runs. The layout is
+ * native-endian and meant for the machine that wrote it. Bump
+ * CHUNK_CACHE_VERSION whenever the bytecode or the code the compiler
+ * emits changes meaning.
+ */
+constexpr uint32_t CHUNK_CACHE_VERSION = 4;
+
+// FNV-1a over the source text.
+uint64_t hash_source(std::string_view text);
+
+// `<script>.xbc`, or `$XERITH_CACHE_DIR/<basename>.xbc` if that is set.
+std::string cache_path(const std::string& script);
+
+// Maps `path` and fills `chunk` if it holds the compiled form of `file`.
+// Spans are rebound to `file`. Returns false on any mismatch.
+bool load_cached_chunk(const std::string& path, FileId file, Chunk& chunk);
+
+// Writes `chunk` for `file` to `path` atomically. Failure is not an error;
+// the script simply gets compiled again next time.
+bool save_cached_chunk(const std::string& path, FileId file, const Chunk& chunk);
+
+} // namespace xerith
+
+#endif // XERITH_CHUNK_CACHE_H
@@ -0,0 +1,315 @@
+#include "compiler.h"
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include "../runtime/heap.h"
+
+namespace xerith {
+
+bool Compiler::compile(const StmtList& statements, Chunk& chunk) {
+    this->chunk = &chunk;
+    local_count = 0;
+    stack_depth = 0;
+    identifiers.clear();
+
+    try {
+        for (Stmt* statement : statements) compile_stmt(*statement);
+        emit_op(OpCode::RETURN);
+    } catch (const std::runtime_error& error) {
+        std::cerr << "[Compile Error] " << error.what() << std::endl;
+        this->chunk = nullptr;
+        return false;
+    }
+
+    this->chunk = nullptr;
+    return true;
+}
+
+void Compiler::compile_expr(Expr& expr) { expr.accept(*this); }
+void Compiler::compile_stmt(Stmt& stmt) { stmt.accept(*this); }
+
+void Compiler::compile_function(FunctionStmt& stmt, Chunk& chunk) {
+    this->chunk = &chunk;
+    // The arguments are already on the stack as the first locals.
+    local_count = static_cast<int>(stmt.params.size());
+    stack_depth = stmt.params.size();
+    chunk.max_stack = stack_depth;
+
+    span = stmt.name.span;
+    for (int slot : stmt.boxed_params) emit_op(OpCode::BOX, slot_operand(slot));
+    for (Stmt* statement : stmt.body) compile_stmt(*statement);
+    span = stmt.span;
+    emit_op(OpCode::NIL);
+    emit_op(OpCode::RETURN);
+}
+
+void Compiler::visit_print_stmt(PrintStmt& stmt) {
+    compile_expr(*stmt.expression);
+    emit_op(OpCode::PRINT);
+}
+
+void Compiler::visit_expression_stmt(ExpressionStmt& stmt) {
+    compile_expr(*stmt.expression);
+    emit_op(OpCode::POP);
+}
+
+void Compiler::visit_var_stmt(VarStmt& stmt) {
+    span = stmt.name.span;
+    if (stmt.initializer != nullptr) compile_expr(*stmt.initializer);
+    else emit_op(OpCode::NIL);
+    define_variable(stmt.slot, stmt.name, stmt.boxed);
+}
+
+void Compiler::visit_function_stmt(FunctionStmt& stmt) {
+    // Nothing collects while compiling; on a compile error the function
+    // is garbage by the next collection.
+    auto* function = Heap::make<CompiledFunction>(stmt.name.interned, static_cast<int>(stmt.params.size()));
+    Value value(function);
+    function->captures = stmt.captures;
+    Compiler body;
+    body.compile_function(stmt, function->chunk);
+    Heap::account(function);
+
+    span = stmt.name.span;
+    // A function that captures nothing needs no closure object at all.
+    OpCode op = stmt.captures.empty() ? OpCode::CONSTANT : OpCode::CLOSURE;
+    if (!stmt.boxed) {
+        emit_op(op, make_constant(std::move(value)));
+        define_variable(stmt.slot, stmt.name, false);
+        return;
+    }
+    // A closure may capture its own name, so the box comes first.
+    emit_op(OpCode::NIL);
+    define_variable(stmt.slot, stmt.name, true);
+    emit_op(op, make_constant(std::move(value)));
+    emit_op(OpCode::SET_BOXED, slot_operand(stmt.slot));
+    emit_op(OpCode::POP);
+}
+
+void Compiler::visit_return_stmt(ReturnStmt& stmt) {
+    if (stmt.tail_call != nullptr) {
+        compile_call(*stmt.tail_call, OpCode::TAIL_CALL);
+        return;
+    }
+    if (stmt.value != nullptr) compile_expr(*stmt.value);
+    span = stmt.keyword.span;
+    if (stmt.value == nullptr) emit_op(OpCode::NIL);
+    emit_op(OpCode::RETURN);
+    // Nothing after a return runs with its value on the stack.
+    adjust_stack(-1);
+}
+
+void Compiler::define_variable(int slot, const Token& name, bool boxed) {
+    if (slot < 0) {
+        emit_op(OpCode::DEFINE_GLOBAL, identifier_constant(name.lexeme));
+        return;
+    }
+
+    // A fresh slot is simply the initializer's value left on the stack.
+    // Redeclaring a name in the same block reuses its slot, matching the
+    // tree-walker where the second `let` overwrites the first.
+    if (slot == local_count) {
+        if (local_count > std::numeric_limits<uint16_t>::max()) {
+            throw std::runtime_error("Too many local variables.");
+        }
+        local_count++;
+    } else {
+        emit_op(OpCode::SET_LOCAL, slot_operand(slot));
+        emit_op(OpCode::POP);
+    }
+    // Every execution of the declaration gets a box of its own.
+    if (boxed) emit_op(OpCode::BOX, slot_operand(slot));
+}
+
+void Compiler::visit_block_stmt(BlockStmt& stmt) {
+    int mark = local_count;
+    for (Stmt* statement : stmt.statements) compile_stmt(*statement);
+    for (; local_count > mark; local_count--) emit_op(OpCode::POP);
+}
+
+void Compiler::visit_while_stmt(WhileStmt& stmt) {
+    size_t loop_start = chunk->code.size();
+    compile_expr(*stmt.condition);
+    size_t exit_jump = emit_jump(OpCode::JUMP_IF_FALSE);
+    compile_stmt(*stmt.body);
+    emit_loop(loop_start);
+    patch_jump(exit_jump);
+}
+
+void Compiler::visit_if_stmt(IfStmt& stmt) {
+    compile_expr(*stmt.condition);
+    size_t then_jump = emit_jump(OpCode::JUMP_IF_FALSE);
+    compile_stmt(*stmt.then_branch);
+
+    if (stmt.else_branch == nullptr) {
+        patch_jump(then_jump);
+        return;
+    }
+
+    size_t else_jump = emit_jump(OpCode::JUMP);
+    patch_jump(then_jump);
+    compile_stmt(*stmt.else_branch);
+    patch_jump(else_jump);
+}
+
+Value Compiler::visit_binary_expr(BinaryExpr& expr) {
+    compile_expr(*expr.left);
+    compile_expr(*expr.right);
+    span = expr.op.span;
+    switch (expr.op.type) {
+        case TokenType::PLUS:          emit_op(OpCode::ADD); break;
+        case TokenType::MINUS:         emit_op(OpCode::SUBTRACT); break;
+        case TokenType::STAR:          emit_op(OpCode::MULTIPLY); break;
+        case TokenType::SLASH:         emit_op(OpCode::DIVIDE); break;
+        case TokenType::GREATER:       emit_op(OpCode::GREATER); break;
+        case TokenType::GREATER_EQUAL: emit_op(OpCode::GREATER_EQUAL); break;
+        case TokenType::LESS:          emit_op(OpCode::LESS); break;
+        case TokenType::LESS_EQUAL:    emit_op(OpCode::LESS_EQUAL); break;
+        case TokenType::EQUAL_EQUAL:   emit_op(OpCode::EQUAL); break;
+        case TokenType::BANG_EQUAL:    emit_op(OpCode::NOT_EQUAL); break;
+        default:
+            // The tree-walker yields nil for operators it does not know.
+            emit_op(OpCode::POP);
+            emit_op(OpCode::POP);
+            emit_op(OpCode::NIL);
+            break;
+    }
+    return Value();
+}
+
+Value Compiler::visit_unary_expr(UnaryExpr& expr) {
+    compile_expr(*expr.right);
+    span = expr.op.span;
+    switch (expr.op.type) {
+        case TokenType::MINUS: emit_op(OpCode::NEGATE); break;
+        case TokenType::BANG:  emit_op(OpCode::NOT); break;
+        default:
+            emit_op(OpCode::POP);
+            emit_op(OpCode::NIL);
+            break;
+    }
+    return Value();
+}
+
+Value Compiler::visit_literal_expr(LiteralExpr& expr) {
+    span = expr.value.span;
+    const Value& constant = expr.constant;
+    switch (constant.get_type()) {
+        case ValueType::NUMBER:
+        case ValueType::STRING:
+            emit_op(OpCode::CONSTANT, make_constant(constant));
+            break;
+        case ValueType::BOOL:
+            emit_op(constant.as_bool() ? OpCode::TRUE : OpCode::FALSE);
+            break;
+        case ValueType::NIL:
+        case ValueType::FUNCTION:  // never literals
+        case ValueType::UPVALUE:
+            emit_op(OpCode::NIL);
+            break;
+    }
+    return Value();
+}
+
+Value Compiler::visit_grouping_expr(GroupingExpr& expr) {
+    compile_expr(*expr.expression);
+    return Value();
+}
+
+Value Compiler::visit_variable_expr(VariableExpr& expr) {
+    span = expr.name.span;
+    const SymbolRef& target = expr.target;
+    if (target.is_global()) emit_op(OpCode::GET_GLOBAL, identifier_constant(expr.name.lexeme));
+    else if (target.is_upvalue()) emit_op(OpCode::GET_UPVALUE, slot_operand(target.upvalue));
+    else emit_op(target.boxed ? OpCode::GET_BOXED : OpCode::GET_LOCAL, slot_operand(target.slot));
+    return Value();
+}
+
+Value Compiler::visit_assign_expr(AssignExpr& expr) {
+    compile_expr(*expr.value);
+    span = expr.name.span;
+    const SymbolRef& target = expr.target;
+    if (target.is_global()) emit_op(OpCode::SET_GLOBAL, identifier_constant(expr.name.lexeme));
+    else if (target.is_upvalue()) emit_op(OpCode::SET_UPVALUE, slot_operand(target.upvalue));
+    else emit_op(target.boxed ? OpCode::SET_BOXED : OpCode::SET_LOCAL, slot_operand(target.slot));
+    return Value();
+}
+
+Value Compiler::visit_call_expr(CallExpr& expr) {
+    compile_call(expr, OpCode::CALL);
+    return Value();
+}
+
+void Compiler::compile_call(CallExpr& expr, OpCode op) {
+    compile_expr(*expr.callee);
+    for (Expr* argument : expr.arguments) compile_expr(*argument);
+    span = expr.paren.span;
+    uint16_t count = static_cast<uint16_t>(expr.arguments.size());
+    emit_op(op, count);
+    // The arguments and callee give way to the result; a tail call
+    // leaves the frame altogether.
+    adjust_stack(-static_cast<int>(count) - (op == OpCode::TAIL_CALL ? 1 : 0));
+}
+
+uint16_t Compiler::slot_operand(int slot) const {
+    if (slot > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("Too many local variables.");
+    }
+    return static_cast<uint16_t>(slot);
+}
+
+uint16_t Compiler::identifier_constant(std::string_view name) {
+    auto it = identifiers.find(name);
+    if (it != identifiers.end()) return it->second;
+    uint16_t index = make_constant(std::string(name));
+    identifiers.emplace(name, index);
+    return index;
+}
+
+uint16_t Compiler::make_constant(Value value) {
+    size_t index = chunk->add_constant(std::move(value));
+    if (index > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("Too many constants in one chunk.");
+    }
+    return static_cast<uint16_t>(index);
+}
+
+void Compiler::emit_op(OpCode op) {
+    chunk->write(static_cast<uint8_t>(op), span);
+    adjust_stack(opcode_stack_effect(op));
+}
+
+void Compiler::emit_op(OpCode op, uint16_t operand) {
+    emit_op(op);
+    chunk->write(static_cast<uint8_t>(operand >> 8), span);
+    chunk->write(static_cast<uint8_t>(operand & 0xff), span);
+}
+
+size_t Compiler::emit_jump(OpCode op) {
+    emit_op(op, 0xffff);
+    return chunk->code.size() - 2;
+}
+
+void Compiler::patch_jump(size_t offset) {
+    size_t jump = chunk->code.size() - offset - 2;
+    if (jump > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("Too much code to jump over.");
+    }
+    chunk->code[offset] = static_cast<uint8_t>(jump >> 8);
+    chunk->code[offset + 1] = static_cast<uint8_t>(jump & 0xff);
+}
+
+void Compiler::emit_loop(size_t loop_start) {
+    size_t offset = chunk->code.size() + 3 - loop_start;
+    if (offset > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("Loop body too large.");
+    }
+    emit_op(OpCode::LOOP, static_cast<uint16_t>(offset));
+}
+
+void Compiler::adjust_stack(int effect) {
+    stack_depth = static_cast<size_t>(static_cast<long>(stack_depth) + effect);
+    if (stack_depth > chunk->max_stack) chunk->max_stack = stack_depth;
+}
+
+} // namespace xerith
@@ -0,0 +1,77 @@
+#ifndef XERITH_COMPILER_H
+#define XERITH_COMPILER_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../parser/ast.h"
+#include "bytecode.h"
+
+namespace xerith {
+
+/**
+ * @brief Lowers a resolved AST into a bytecode Chunk.
+ * Top-level `let`s become globals; everything declared inside a block
+ * lives in the stack slot the Resolver assigned to it, which the VM
+ * addresses directly. Each function body gets a chunk of its own, held
+ * by a CompiledFunction constant of the chunk that declares it. Slots
+ * the Resolver marked as captured hold an ObjUpvalue instead, read and
+ * written through the *_BOXED opcodes.
+ */
+class Compiler : public ExprVisitor, public StmtVisitor {
+public:
+    // Returns false (after reporting) if the program cannot be compiled.
+    bool compile(const StmtList& statements, Chunk& chunk);
+
+    // Stmt Visitor Methods
+    void visit_print_stmt(PrintStmt& stmt) override;
+    void visit_expression_stmt(ExpressionStmt& stmt) override;
+    void visit_var_stmt(VarStmt& stmt) override;
+    void visit_block_stmt(BlockStmt& stmt) override;
+    void visit_while_stmt(WhileStmt& stmt) override;
+    void visit_if_stmt(IfStmt& stmt) override;
+    void visit_function_stmt(FunctionStmt& stmt) override;
+    void visit_return_stmt(ReturnStmt& stmt) override;
+
+    // Expr Visitor Methods. The returned Value is unused; code is emitted
+    // into the current chunk instead.
+    Value visit_binary_expr(BinaryExpr& expr) override;
+    Value visit_unary_expr(UnaryExpr& expr) override;
+    Value visit_literal_expr(LiteralExpr& expr) override;
+    Value visit_grouping_expr(GroupingExpr& expr) override;
+    Value visit_variable_expr(VariableExpr& expr) override;
+    Value visit_assign_expr(AssignExpr& expr) override;
+    Value visit_call_expr(CallExpr& expr) override;
+
+private:
+    void compile_expr(Expr& expr);
+    void compile_stmt(Stmt& stmt);
+    void compile_function(FunctionStmt& stmt, Chunk& chunk);
+    // Emits CALL or TAIL_CALL for `expr`.
+    void compile_call(CallExpr& expr, OpCode op);
+    // Binds the value on top of the stack to a declared name, boxing it
+    // if a closure captures it.
+    void define_variable(int slot, const Token& name, bool boxed);
+
+    uint16_t slot_operand(int slot) const;
+    uint16_t identifier_constant(std::string_view name);
+    uint16_t make_constant(Value value);
+
+    void emit_op(OpCode op);
+    void emit_op(OpCode op, uint16_t operand);
+    size_t emit_jump(OpCode op);
+    void patch_jump(size_t offset);
+    void emit_loop(size_t loop_start);
+    void adjust_stack(int effect);
+
+    Chunk* chunk = nullptr;
+    Span span;  // source location stamped on emitted bytes
+    int local_count = 0;  // slots currently live on the VM stack
+    size_t stack_depth = 0;
+    std::unordered_map<std::string_view, uint16_t> identifiers;
+};
+
+} // namespace xerith
+
+#endif // XERITH_COMPILER_H
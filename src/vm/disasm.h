@@ -1 +1,73 @@
-// Will be written soon
+#ifndef XERITH_DISASM_H
+#define XERITH_DISASM_H
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include "bytecode.h"
+#include "../utils/source_manager.h"
+
+namespace xerith {
+
+/**
+ * @brief Prints one instruction and returns the offset of the next one.
+ */
+inline size_t disassemble_instruction(const Chunk& chunk, size_t offset, std::ostream& os = std::cout) {
+    char prefix[32];
+    int line = SourceManager::resolve(chunk.spans[offset]).line;
+    bool same_line = offset > 0 && line == SourceManager::resolve(chunk.spans[offset - 1]).line;
+    if (same_line) std::snprintf(prefix, sizeof(prefix), "%04zu    | ", offset);
+    else std::snprintf(prefix, sizeof(prefix), "%04zu %4d ", offset, line);
+    os << prefix;
+
+    OpCode op = static_cast<OpCode>(chunk.code[offset]);
+    OperandKind kind = opcode_operand(op);
+    if (kind == OperandKind::NONE) {
+        os << opcode_name(op) << "\n";
+        return offset + 1;
+    }
+
+    uint16_t operand = static_cast<uint16_t>((chunk.code[offset + 1] << 8) | chunk.code[offset + 2]);
+    char text[64];
+    std::snprintf(text, sizeof(text), "%-16s %5u", opcode_name(op), operand);
+    os << text;
+
+    switch (kind) {
+        case OperandKind::CONSTANT:
+            os << " '" << to_string(chunk.constants[operand]) << "'";
+            if (op == OpCode::CLOSURE) {
+                const auto* function = static_cast<const CompiledFunction*>(chunk.constants[operand].as_function());
+                for (const Capture& capture : function->captures) {
+                    os << (capture.local ? " local " : " upvalue ") << capture.index;
+                }
+            }
+            break;
+        case OperandKind::JUMP:
+            os << " -> " << offset + 3 + operand;
+            break;
+        case OperandKind::LOOP:
+            os << " -> " << offset + 3 - operand;
+            break;
+        default:
+            break;
+    }
+    os << "\n";
+    return offset + 3;
+}
+
+// Prints `chunk`, then the chunk of every function it declares.
+inline void disassemble_chunk(const Chunk& chunk, const std::string& name, std::ostream& os = std::cout) {
+    os << "== " << name << " ==\n";
+    for (size_t offset = 0; offset < chunk.code.size();) {
+        offset = disassemble_instruction(chunk, offset, os);
+    }
+    for (const Value& constant : chunk.constants) {
+        if (!constant.is_function()) continue;
+        const auto* function = static_cast<const CompiledFunction*>(constant.as_function());
+        disassemble_chunk(function->chunk, "fn " + function->name->chars, os);
+    }
+}
+
+} // namespace xerith
+
+#endif // XERITH_DISASM_H
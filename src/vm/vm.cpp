@@ -1 +1,466 @@
-// Will be written soon
+#include "vm.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include "../runtime/natives.h"
+#include "../utils/stats.h"
+
+// Labels-as-values dispatch is a GNU extension; everything else falls back
+// to a plain switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define XERITH_COMPUTED_GOTO 1
+#else
+#define XERITH_COMPUTED_GOTO 0
+#endif
+
+namespace xerith {
+
+namespace {
+
+// Chunks keep their caches between runs and may be run by more than one
+// VM, so versions are never reused, even across VMs.
+uint32_t next_globals_version() {
+    static std::atomic<uint32_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The code a compiled function or closure runs, and the upvalues it sees.
+const CompiledFunction* unwrap(ObjFunction* function, const Value*& upvalues) {
+    if (function->kind == FunctionKind::CLOSURE) {
+        auto* closure = static_cast<Closure*>(function);
+        upvalues = closure->upvalues.data();
+        return closure->function();
+    }
+    upvalues = nullptr;
+    return static_cast<const CompiledFunction*>(function);
+}
+
+// Forgets every cell a chunk and the functions declared in it cached.
+// Versions already keep a stale cache from being trusted; the reset
+// makes rerunning a chunk start from the same state as a fresh one.
+void reset_global_caches(const Chunk& chunk) {
+    std::fill(chunk.global_caches.begin(), chunk.global_caches.end(), GlobalCache{});
+    for (const Value& constant : chunk.constants) {
+        if (constant.is_function() && constant.as_function()->kind == FunctionKind::COMPILED) {
+            reset_global_caches(static_cast<const CompiledFunction*>(constant.as_function())->chunk);
+        }
+    }
+}
+
+} // namespace
+
+VM::VM() : globals_version(next_globals_version()) {
+    for (size_t i = 0; i < native_count(); i++) {
+        GlobalCache cache;
+        *define_global(native(i)->name, cache) = Value(native(i));
+    }
+}
+
+InterpretResult VM::interpret(const Chunk& chunk) {
+    reset_global_caches(chunk);
+    script = &chunk;
+    try {
+        run(chunk);
+    } catch (const std::runtime_error& error) {
+        std::cerr << "Runtime Error: " << error.what() << std::endl;
+        if (profiler != nullptr) {
+            for (size_t i = 1; i < frames.size(); i++) profiler->leave();
+        }
+        frames.clear();
+        stack.clear();
+        script = nullptr;
+        return InterpretResult::RUNTIME_ERROR;
+    }
+    frames.clear();
+    stack.clear();
+    script = nullptr;
+    return InterpretResult::OK;
+}
+
+void VM::trace_roots(Tracer& tracer) const {
+    // Slots above the top are nil or stale copies; marking them is
+    // merely conservative.
+    for (const Value& value : stack) tracer.mark(value);
+    for (const Value& value : global_values) tracer.mark(value);
+    // A frame's upvalues belong to the closure in the slot below it.
+    for (const CallFrame& frame : frames) tracer.mark(frame.function);
+    if (script != nullptr) {
+        for (const Value& constant : script->constants) tracer.mark(constant);
+    }
+}
+
+ObjFunction* VM::check_call(const Value& callee, int count) {
+    if (!callee.is_function()) throw std::runtime_error("Can only call functions.");
+    ObjFunction* function = callee.as_function();
+    if (function->arity != count) {
+        throw std::runtime_error("Expected " + std::to_string(function->arity) + " arguments but got " +
+                                 std::to_string(count) + ".");
+    }
+    return function;
+}
+
+Value* VM::find_global(const ObjString* name, GlobalCache& cache) {
+    auto it = global_slots.find(name);
+    if (it == global_slots.end()) return nullptr;
+    cache = {&global_values[it->second], globals_version};
+    return cache.cell;
+}
+
+Value* VM::define_global(const ObjString* name, GlobalCache& cache) {
+    auto [it, added] = global_slots.emplace(name, static_cast<uint32_t>(global_values.size()));
+    if (added) {
+        if (global_values.size() == global_values.capacity()) globals_version = next_globals_version();
+        global_values.emplace_back();
+    }
+    cache = {&global_values[it->second], globals_version};
+    return cache.cell;
+}
+
+void VM::run(const Chunk& script) {
+    // The compiler knows the deepest each chunk's operand stack can get,
+    // so the dispatch loop never has to bounds-check a push; only a call
+    // checks that its callee's share still fits.
+    stack.clear();
+    stack.resize(script.max_stack + 1);
+    frames.clear();
+    frames.push_back({nullptr, nullptr, 0, nullptr});
+
+    const Chunk* chunk = &script;
+    const uint8_t* ip = chunk->code.data();
+    const Value* constants = chunk->constants.data();
+    GlobalCache* caches = chunk->global_caches.data();
+    const Value* upvalues = nullptr;
+    Value* base = stack.data();
+    Value* sp = base;
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+#define PUSH(value) (*sp++ = (value))
+#define POP() (std::move(*--sp))
+
+// Switches the cached chunk state to `frame`'s function.
+#define LOAD_FRAME(frame)                                                    \
+    do {                                                                     \
+        chunk = (frame).function != nullptr ? &(frame).function->chunk : &script; \
+        constants = chunk->constants.data();                                 \
+        caches = chunk->global_caches.data();                                \
+        base = stack.data() + (frame).slots;                                 \
+        upvalues = (frame).upvalues;                                         \
+    } while (0)
+
+// Moves the stack if the callee's frame, starting at `first`, would not fit.
+#define RESERVE_FRAME(first, function)                                       \
+    do {                                                                     \
+        size_t first_slot = static_cast<size_t>((first) - stack.data());     \
+        size_t needed = first_slot + (function)->chunk.max_stack + 1;        \
+        if (needed > stack.size()) {                                         \
+            size_t top = static_cast<size_t>(sp - stack.data());             \
+            size_t frame_base = static_cast<size_t>(base - stack.data());    \
+            stack.resize(std::max(needed, stack.size() * 2));                \
+            sp = stack.data() + top;                                         \
+            base = stack.data() + frame_base;                                \
+        }                                                                    \
+    } while (0)
+
+#define NUMBER_OPERANDS()                                                    \
+    if (!sp[-2].is_number() || !sp[-1].is_number())                          \
+        throw std::runtime_error("Operands must be numbers.")
+
+#define BINARY_OP(op)                                                        \
+    do {                                                                     \
+        NUMBER_OPERANDS();                                                   \
+        double b = sp[-1].as_number();                                       \
+        sp[-2] = Value(sp[-2].as_number() op b);                             \
+        --sp;                                                                \
+    } while (0)
+
+#if XERITH_COMPUTED_GOTO
+    static void* dispatch_table[] = {
+#define XERITH_OPCODE_LABEL(name, operand, effect) &&op_##name,
+        XERITH_OPCODES(XERITH_OPCODE_LABEL)
+#undef XERITH_OPCODE_LABEL
+    };
+    // Profiling and --stats route every opcode through one hook instead of
+    // testing flags per instruction, so a plain run dispatches as before.
+    static void* instrumented_table[] = {
+#define XERITH_OPCODE_HOOK(name, operand, effect) &&instrument_instruction,
+        XERITH_OPCODES(XERITH_OPCODE_HOOK)
+#undef XERITH_OPCODE_HOOK
+    };
+    bool instrumented = profiler != nullptr || Stats::enabled();
+    void* const* table = instrumented ? instrumented_table : dispatch_table;
+#define DISPATCH() goto *table[READ_BYTE()]
+#define CASE(name) op_##name:
+    DISPATCH();
+
+instrument_instruction:
+    if (profiler != nullptr) profiler->at(chunk->spans[ip - 1 - chunk->code.data()]);
+    XERITH_STATS_COUNT(OPCODES, 1);
+    goto *dispatch_table[ip[-1]];
+#else
+#define DISPATCH() break
+#define CASE(name) case OpCode::name:
+    for (;;) {
+    if (profiler != nullptr) profiler->at(chunk->spans[ip - chunk->code.data()]);
+    XERITH_STATS_COUNT(OPCODES, 1);
+    switch (static_cast<OpCode>(READ_BYTE())) {
+#endif
+
+    CASE(CONSTANT) {
+        PUSH(constants[READ_SHORT()]);
+        DISPATCH();
+    }
+    CASE(NIL) {
+        PUSH(Value());
+        DISPATCH();
+    }
+    CASE(TRUE) {
+        PUSH(Value(true));
+        DISPATCH();
+    }
+    CASE(FALSE) {
+        PUSH(Value(false));
+        DISPATCH();
+    }
+    CASE(POP) {
+        *--sp = Value();
+        DISPATCH();
+    }
+    CASE(GET_LOCAL) {
+        PUSH(base[READ_SHORT()]);
+        DISPATCH();
+    }
+    CASE(SET_LOCAL) {
+        base[READ_SHORT()] = sp[-1];
+        DISPATCH();
+    }
+    CASE(BOX) {
+        Value& slot = base[READ_SHORT()];
+        Value box(Heap::make<ObjUpvalue>(std::move(slot)));
+        slot = std::move(box);
+        Heap::safepoint();
+        DISPATCH();
+    }
+    CASE(GET_BOXED) {
+        PUSH(base[READ_SHORT()].as_upvalue()->value);
+        DISPATCH();
+    }
+    CASE(SET_BOXED) {
+        base[READ_SHORT()].as_upvalue()->value = sp[-1];
+        DISPATCH();
+    }
+    CASE(GET_UPVALUE) {
+        PUSH(upvalues[READ_SHORT()].as_upvalue()->value);
+        DISPATCH();
+    }
+    CASE(SET_UPVALUE) {
+        upvalues[READ_SHORT()].as_upvalue()->value = sp[-1];
+        DISPATCH();
+    }
+    CASE(GET_GLOBAL) {
+        uint16_t index = READ_SHORT();
+        GlobalCache& cache = caches[index];
+        Value* cell = cache.version == globals_version ? cache.cell
+                                                        : find_global(constants[index].as_object(), cache);
+        if (cell == nullptr) throw std::runtime_error("Undefined variable '" + constants[index].as_object()->chars + "'.");
+        PUSH(*cell);
+        DISPATCH();
+    }
+    CASE(DEFINE_GLOBAL) {
+        uint16_t index = READ_SHORT();
+        GlobalCache& cache = caches[index];
+        Value* cell = cache.version == globals_version ? cache.cell
+                                                        : define_global(constants[index].as_object(), cache);
+        *cell = POP();
+        DISPATCH();
+    }
+    CASE(SET_GLOBAL) {
+        uint16_t index = READ_SHORT();
+        GlobalCache& cache = caches[index];
+        Value* cell = cache.version == globals_version ? cache.cell
+                                                        : find_global(constants[index].as_object(), cache);
+        if (cell == nullptr) throw std::runtime_error("Undefined variable '" + constants[index].as_object()->chars + "'.");
+        *cell = sp[-1];
+        DISPATCH();
+    }
+    CASE(EQUAL) {
+        Value b = POP();
+        sp[-1] = Value(values_equal(sp[-1], b));
+        DISPATCH();
+    }
+    CASE(NOT_EQUAL) {
+        Value b = POP();
+        sp[-1] = Value(!values_equal(sp[-1], b));
+        DISPATCH();
+    }
+    CASE(GREATER) {
+        BINARY_OP(>);
+        DISPATCH();
+    }
+    CASE(GREATER_EQUAL) {
+        BINARY_OP(>=);
+        DISPATCH();
+    }
+    CASE(LESS) {
+        BINARY_OP(<);
+        DISPATCH();
+    }
+    CASE(LESS_EQUAL) {
+        BINARY_OP(<=);
+        DISPATCH();
+    }
+    CASE(ADD) {
+        if (sp[-2].is_number() && sp[-1].is_number()) {
+            double b = sp[-1].as_number();
+            sp[-2] = Value(sp[-2].as_number() + b);
+            --sp;
+        } else if (sp[-2].is_string() && sp[-1].is_string()) {
+            Value b = POP();
+            sp[-1] = concat(sp[-1], b);
+        } else {
+            throw std::runtime_error("Operands must be two numbers or two strings.");
+        }
+        DISPATCH();
+    }
+    CASE(SUBTRACT) {
+        BINARY_OP(-);
+        DISPATCH();
+    }
+    CASE(MULTIPLY) {
+        BINARY_OP(*);
+        DISPATCH();
+    }
+    CASE(DIVIDE) {
+        BINARY_OP(/);
+        DISPATCH();
+    }
+    CASE(NOT) {
+        sp[-1] = Value(!is_truthy(sp[-1]));
+        DISPATCH();
+    }
+    CASE(NEGATE) {
+        if (!sp[-1].is_number()) throw std::runtime_error("Operand must be a number.");
+        sp[-1] = Value(-sp[-1].as_number());
+        DISPATCH();
+    }
+    CASE(PRINT) {
+        Value value = POP();
+        std::cout << to_string(value) << std::endl;
+        DISPATCH();
+    }
+    CASE(JUMP) {
+        uint16_t offset = READ_SHORT();
+        ip += offset;
+        DISPATCH();
+    }
+    CASE(JUMP_IF_FALSE) {
+        uint16_t offset = READ_SHORT();
+        if (!is_truthy(POP())) ip += offset;
+        DISPATCH();
+    }
+    CASE(LOOP) {
+        uint16_t offset = READ_SHORT();
+        ip -= offset;
+        DISPATCH();
+    }
+    CASE(CLOSURE) {
+        const Value& prototype = constants[READ_SHORT()];
+        auto* closure = Heap::make<Closure>(prototype);
+        Value value(closure);
+        const std::vector<Capture>& captures = closure->function()->captures;
+        closure->upvalues.reserve(captures.size());
+        for (const Capture& capture : captures) {
+            closure->upvalues.push_back(capture.local ? base[capture.index] : upvalues[capture.index]);
+        }
+        Heap::account(closure);
+        PUSH(std::move(value));
+        Heap::safepoint();
+        DISPATCH();
+    }
+    CASE(CALL) {
+        uint16_t count = READ_SHORT();
+        ObjFunction* function = check_call(sp[-count - 1], count);
+        XERITH_STATS_COUNT(CALLS, 1);
+        if (function->kind == FunctionKind::NATIVE) {
+            Value* arguments = sp - count;
+            Value result = static_cast<NativeFunction*>(function)->function(arguments);
+            while (sp > arguments) *--sp = Value();
+            sp[-1] = std::move(result);
+            DISPATCH();
+        }
+        const Value* captured;
+        const CompiledFunction* callee = unwrap(function, captured);
+        if (frames.size() == MAX_FRAMES) throw std::runtime_error("Stack overflow.");
+        RESERVE_FRAME(sp - count, callee);
+        frames.back().ip = ip;
+        frames.push_back({callee, nullptr, static_cast<size_t>(sp - count - stack.data()), captured});
+        LOAD_FRAME(frames.back());
+        ip = chunk->code.data();
+        if (profiler != nullptr) profiler->enter(callee->name->chars.c_str());
+        DISPATCH();
+    }
+    CASE(TAIL_CALL) {
+        uint16_t count = READ_SHORT();
+        ObjFunction* function = check_call(sp[-count - 1], count);
+        XERITH_STATS_COUNT(CALLS, 1);
+        if (function->kind == FunctionKind::NATIVE) {
+            Value* arguments = sp - count;
+            Value result = static_cast<NativeFunction*>(function)->function(arguments);
+            while (sp > arguments) *--sp = Value();
+            sp[-1] = std::move(result);
+            goto return_value;
+        }
+        // Replace this frame: the callee and its arguments slide down to
+        // where this function and its arguments were, and run from there.
+        // The callee's slot keeps a closure, and so `captured`, alive.
+        const Value* captured;
+        const CompiledFunction* callee = unwrap(function, captured);
+        Value* from = sp - count - 1;
+        Value* to = base - 1;
+        for (int i = 0; i <= count; i++) to[i] = std::move(from[i]);
+        Value* top = to + count + 1;
+        while (sp > top) *--sp = Value();
+        RESERVE_FRAME(base, callee);
+        frames.back().function = callee;
+        frames.back().upvalues = captured;
+        LOAD_FRAME(frames.back());
+        ip = chunk->code.data();
+        if (profiler != nullptr) {
+            profiler->leave();
+            profiler->enter(callee->name->chars.c_str());
+        }
+        DISPATCH();
+    }
+    CASE(RETURN) {
+        if (frames.size() == 1) return;
+    return_value:
+        // Drops the callee, its arguments and locals, leaving the result.
+        Value result = POP();
+        while (sp > base - 1) *--sp = Value();
+        PUSH(std::move(result));
+        frames.pop_back();
+        LOAD_FRAME(frames.back());
+        ip = frames.back().ip;
+        if (profiler != nullptr) profiler->leave();
+        DISPATCH();
+    }
+
+#if !XERITH_COMPUTED_GOTO
+    }
+    }
+#endif
+
+#undef CASE
+#undef DISPATCH
+#undef RESERVE_FRAME
+#undef LOAD_FRAME
+#undef BINARY_OP
+#undef NUMBER_OPERANDS
+#undef POP
+#undef PUSH
+#undef READ_SHORT
+#undef READ_BYTE
+}
+
+} // namespace xerith
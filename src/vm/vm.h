@@ -1 +1,68 @@
-// Will be written soon
+#ifndef XERITH_VM_H
+#define XERITH_VM_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bytecode.h"
+#include "../runtime/heap.h"
+#include "../runtime/profiler.h"
+
+namespace xerith {
+
+enum class InterpretResult {
+    OK, RUNTIME_ERROR
+};
+
+/**
+ * @brief Stack-based bytecode interpreter.
+ * Globals persist across `interpret` calls so the REPL can feed it one
+ * chunk per line. Calls push a CallFrame; a function's arguments are its
+ * first slots, directly above the callee on the one operand stack. The
+ * stack, frames, globals and running chunk are the collector's roots.
+ */
+class VM : public RootSource {
+public:
+    // Deepest non-tail recursion before "Stack overflow.".
+    static constexpr size_t MAX_FRAMES = 10000;
+
+    VM();
+
+    InterpretResult interpret(const Chunk& chunk);
+
+    // Publishes each instruction's span to `profiler`; null stops.
+    void set_profiler(Profiler* profiler) { this->profiler = profiler; }
+
+    void trace_roots(Tracer& tracer) const override;
+
+private:
+    struct CallFrame {
+        const CompiledFunction* function;  // null for the script itself
+        const uint8_t* ip;                 // where to resume once a callee returns
+        size_t slots;                      // stack index of the first argument
+        const Value* upvalues;             // the closure's boxes; null if it has none
+    };
+
+    void run(const Chunk& chunk);
+    // Slow paths behind GlobalCache: look the name up and refill `cache`.
+    Value* find_global(const ObjString* name, GlobalCache& cache);
+    Value* define_global(const ObjString* name, GlobalCache& cache);
+    // Checks that `callee` can take `count` arguments.
+    static ObjFunction* check_call(const Value& callee, int count);
+
+    std::vector<Value> stack;
+    std::vector<CallFrame> frames;
+    const Chunk* script = nullptr;  // the chunk being run, for its constants
+    Profiler* profiler = nullptr;
+    // Globals live in `global_values`, numbered on first definition;
+    // `global_slots` is keyed by the interned name constants, which are
+    // pinned identifiers. Each chunk caches the cells it uses.
+    std::vector<Value> global_values;
+    std::unordered_map<const ObjString*, uint32_t> global_slots;
+    uint32_t globals_version;
+};
+
+} // namespace xerith
+
+#endif // XERITH_VM_H